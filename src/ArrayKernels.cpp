@@ -0,0 +1,295 @@
+#include "ArrayKernels.h"
+#include <algorithm>
+#include <atomic>
+#include <type_traits>
+
+#if (defined(__GNUC__) || defined(__clang__)) &&                              \
+    (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2_KERNELS 1
+#include <immintrin.h>
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace Forwarder {
+namespace ArrayKernels {
+
+static InstructionSet detect() {
+#ifdef HAVE_AVX2_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return InstructionSet::AVX2;
+  }
+#endif
+  return InstructionSet::Scalar;
+}
+
+static InstructionSet const &best() {
+  static InstructionSet const Best = detect();
+  return Best;
+}
+
+static std::atomic<InstructionSet> &active() {
+  static std::atomic<InstructionSet> Active{best()};
+  return Active;
+}
+
+InstructionSet instructionSet() { return active().load(); }
+
+bool supported(InstructionSet Set) {
+  return Set == InstructionSet::Scalar || Set == best();
+}
+
+InstructionSet useInstructionSet(InstructionSet Wanted) {
+  auto Set = supported(Wanted) ? Wanted : InstructionSet::Scalar;
+  active().store(Set);
+  return Set;
+}
+
+char const *instructionSetName(InstructionSet Set) {
+  switch (Set) {
+  case InstructionSet::Scalar:
+    return "scalar";
+  case InstructionSet::AVX2:
+    return "avx2";
+  }
+  return "unknown";
+}
+
+/// Integers of up to 32 bits are summed exactly.
+template <typename T>
+using Accumulator = typename std::conditional<
+    std::is_floating_point<T>::value || (sizeof(T) > 4), double,
+    int64_t>::type;
+
+template <typename T>
+static Summary<T> summarizeScalar(T const *Data, size_t Count) {
+  Summary<T> Result;
+  Result.Count = Count;
+  if (Count == 0) {
+    return Result;
+  }
+  T Min = Data[0];
+  T Max = Data[0];
+  Accumulator<T> Sum = 0;
+  for (size_t i = 0; i < Count; ++i) {
+    auto Value = Data[i];
+    Min = Value < Min ? Value : Min;
+    Max = Value > Max ? Value : Max;
+    Sum += Value;
+  }
+  Result.Min = Min;
+  Result.Max = Max;
+  Result.Sum = static_cast<double>(Sum);
+  return Result;
+}
+
+#ifdef HAVE_AVX2_KERNELS
+
+static bool useAVX2() {
+  return active().load(std::memory_order_relaxed) == InstructionSet::AVX2;
+}
+
+/// Combines the lanes of the vector registers and the scalar tail.
+template <typename T, typename Lanes>
+static void reduceLanes(Summary<T> &Result, Lanes const &MinLanes,
+                        Lanes const &MaxLanes, T const *Tail,
+                        size_t TailCount) {
+  for (auto Value : MinLanes) {
+    Result.Min = std::min(Result.Min, Value);
+  }
+  for (auto Value : MaxLanes) {
+    Result.Max = std::max(Result.Max, Value);
+  }
+  auto TailSummary = summarizeScalar(Tail, TailCount);
+  if (TailCount > 0) {
+    Result.Min = std::min(Result.Min, TailSummary.Min);
+    Result.Max = std::max(Result.Max, TailSummary.Max);
+  }
+  Result.Sum += TailSummary.Sum;
+}
+
+TARGET_AVX2 static int64_t sumLanes64(__m256i Sum) {
+  alignas(32) int64_t Lanes[4];
+  _mm256_store_si256(reinterpret_cast<__m256i *>(Lanes), Sum);
+  return Lanes[0] + Lanes[1] + Lanes[2] + Lanes[3];
+}
+
+TARGET_AVX2 static double sumLanes(__m256d Sum) {
+  alignas(32) double Lanes[4];
+  _mm256_store_pd(Lanes, Sum);
+  return (Lanes[0] + Lanes[1]) + (Lanes[2] + Lanes[3]);
+}
+
+TARGET_AVX2 static Summary<int16_t> summarizeAVX2(int16_t const *Data,
+                                                  size_t Count) {
+  Summary<int16_t> Result;
+  Result.Count = Count;
+  if (Count < 16) {
+    return summarizeScalar(Data, Count);
+  }
+  auto Min = _mm256_set1_epi16(Data[0]);
+  auto Max = Min;
+  auto Ones = _mm256_set1_epi16(1);
+  auto Sum = _mm256_setzero_si256();
+  size_t i = 0;
+  while (Count - i >= 16) {
+    // The pairwise sums of up to 2^14 vectors fit into 32 bit lanes.
+    auto Vectors = std::min<size_t>((Count - i) / 16, 1 << 14);
+    auto BlockSum = _mm256_setzero_si256();
+    for (size_t k = 0; k < Vectors; ++k, i += 16) {
+      auto Value =
+          _mm256_loadu_si256(reinterpret_cast<__m256i const *>(Data + i));
+      Min = _mm256_min_epi16(Min, Value);
+      Max = _mm256_max_epi16(Max, Value);
+      BlockSum = _mm256_add_epi32(BlockSum, _mm256_madd_epi16(Value, Ones));
+    }
+    Sum = _mm256_add_epi64(
+        Sum, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(BlockSum)));
+    Sum = _mm256_add_epi64(
+        Sum, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(BlockSum, 1)));
+  }
+  alignas(32) int16_t MinLanes[16];
+  alignas(32) int16_t MaxLanes[16];
+  _mm256_store_si256(reinterpret_cast<__m256i *>(MinLanes), Min);
+  _mm256_store_si256(reinterpret_cast<__m256i *>(MaxLanes), Max);
+  Result.Min = Result.Max = Data[0];
+  Result.Sum = static_cast<double>(sumLanes64(Sum));
+  reduceLanes(Result, MinLanes, MaxLanes, Data + i, Count - i);
+  return Result;
+}
+
+TARGET_AVX2 static Summary<int32_t> summarizeAVX2(int32_t const *Data,
+                                                  size_t Count) {
+  Summary<int32_t> Result;
+  Result.Count = Count;
+  if (Count < 8) {
+    return summarizeScalar(Data, Count);
+  }
+  auto Min = _mm256_set1_epi32(Data[0]);
+  auto Max = Min;
+  auto SumLow = _mm256_setzero_si256();
+  auto SumHigh = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; Count - i >= 8; i += 8) {
+    auto Value =
+        _mm256_loadu_si256(reinterpret_cast<__m256i const *>(Data + i));
+    Min = _mm256_min_epi32(Min, Value);
+    Max = _mm256_max_epi32(Max, Value);
+    SumLow = _mm256_add_epi64(
+        SumLow, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(Value)));
+    SumHigh = _mm256_add_epi64(
+        SumHigh, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(Value, 1)));
+  }
+  alignas(32) int32_t MinLanes[8];
+  alignas(32) int32_t MaxLanes[8];
+  _mm256_store_si256(reinterpret_cast<__m256i *>(MinLanes), Min);
+  _mm256_store_si256(reinterpret_cast<__m256i *>(MaxLanes), Max);
+  Result.Min = Result.Max = Data[0];
+  Result.Sum = static_cast<double>(sumLanes64(SumLow) + sumLanes64(SumHigh));
+  reduceLanes(Result, MinLanes, MaxLanes, Data + i, Count - i);
+  return Result;
+}
+
+TARGET_AVX2 static Summary<float> summarizeAVX2(float const *Data,
+                                                size_t Count) {
+  Summary<float> Result;
+  Result.Count = Count;
+  if (Count < 8) {
+    return summarizeScalar(Data, Count);
+  }
+  auto Min = _mm256_set1_ps(Data[0]);
+  auto Max = Min;
+  auto SumLow = _mm256_setzero_pd();
+  auto SumHigh = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; Count - i >= 8; i += 8) {
+    auto Value = _mm256_loadu_ps(Data + i);
+    Min = _mm256_min_ps(Min, Value);
+    Max = _mm256_max_ps(Max, Value);
+    // Summed in double precision like the scalar version.
+    SumLow = _mm256_add_pd(SumLow,
+                           _mm256_cvtps_pd(_mm256_castps256_ps128(Value)));
+    SumHigh = _mm256_add_pd(SumHigh,
+                            _mm256_cvtps_pd(_mm256_extractf128_ps(Value, 1)));
+  }
+  alignas(32) float MinLanes[8];
+  alignas(32) float MaxLanes[8];
+  _mm256_store_ps(MinLanes, Min);
+  _mm256_store_ps(MaxLanes, Max);
+  Result.Min = Result.Max = Data[0];
+  Result.Sum = sumLanes(SumLow) + sumLanes(SumHigh);
+  reduceLanes(Result, MinLanes, MaxLanes, Data + i, Count - i);
+  return Result;
+}
+
+TARGET_AVX2 static Summary<double> summarizeAVX2(double const *Data,
+                                                 size_t Count) {
+  Summary<double> Result;
+  Result.Count = Count;
+  if (Count < 8) {
+    return summarizeScalar(Data, Count);
+  }
+  auto Min = _mm256_set1_pd(Data[0]);
+  auto Max = Min;
+  // Two accumulators hide the latency of the additions.
+  auto SumA = _mm256_setzero_pd();
+  auto SumB = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; Count - i >= 8; i += 8) {
+    auto ValueA = _mm256_loadu_pd(Data + i);
+    auto ValueB = _mm256_loadu_pd(Data + i + 4);
+    Min = _mm256_min_pd(Min, _mm256_min_pd(ValueA, ValueB));
+    Max = _mm256_max_pd(Max, _mm256_max_pd(ValueA, ValueB));
+    SumA = _mm256_add_pd(SumA, ValueA);
+    SumB = _mm256_add_pd(SumB, ValueB);
+  }
+  alignas(32) double MinLanes[4];
+  alignas(32) double MaxLanes[4];
+  _mm256_store_pd(MinLanes, Min);
+  _mm256_store_pd(MaxLanes, Max);
+  Result.Min = Result.Max = Data[0];
+  Result.Sum = sumLanes(SumA) + sumLanes(SumB);
+  reduceLanes(Result, MinLanes, MaxLanes, Data + i, Count - i);
+  return Result;
+}
+
+#endif
+
+template <typename T>
+static Summary<T> dispatchSummarize(T const *Data, size_t Count) {
+  return summarizeScalar(Data, Count);
+}
+
+#ifdef HAVE_AVX2_KERNELS
+#define DISPATCH_AVX2(T)                                                       \
+  static Summary<T> dispatchSummarize(T const *Data, size_t Count) {           \
+    if (useAVX2()) {                                                           \
+      return summarizeAVX2(Data, Count);                                       \
+    }                                                                          \
+    return summarizeScalar(Data, Count);                                       \
+  }
+DISPATCH_AVX2(int16_t)
+DISPATCH_AVX2(int32_t)
+DISPATCH_AVX2(float)
+DISPATCH_AVX2(double)
+#undef DISPATCH_AVX2
+#endif
+
+template <typename T> Summary<T> summarize(T const *Data, size_t Count) {
+  return dispatchSummarize(Data, Count);
+}
+
+#define M(T) template Summary<T> summarize(T const *, size_t);
+M(int8_t)
+M(uint8_t)
+M(int16_t)
+M(uint16_t)
+M(int32_t)
+M(uint32_t)
+M(int64_t)
+M(uint64_t)
+M(float)
+M(double)
+#undef M
+}
+}
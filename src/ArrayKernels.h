@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Forwarder {
+
+/// \brief
+/// Kernels for large arrays, for example waveforms of detector PVs.
+///
+/// Every kernel has a portable scalar implementation. On x86 an AVX2
+/// implementation is used instead when the CPU supports it. This is checked
+/// once at runtime, so the forwarder does not have to be built for AVX2.
+namespace ArrayKernels {
+
+enum class InstructionSet { Scalar, AVX2 };
+
+/// The instruction set which the kernels currently use.
+InstructionSet instructionSet();
+
+/// Makes the kernels use the given instruction set if the CPU supports it,
+/// otherwise the scalar implementations.
+///
+/// \return The instruction set which is used from now on.
+InstructionSet useInstructionSet(InstructionSet Wanted);
+
+/// Whether the CPU supports the instruction set.
+bool supported(InstructionSet Set);
+
+char const *instructionSetName(InstructionSet Set);
+
+template <typename T> struct Summary {
+  /// Zero for an empty array.
+  T Min = T();
+  /// Zero for an empty array.
+  T Max = T();
+  /// Exact for integer types of up to 32 bits.
+  double Sum = 0;
+  size_t Count = 0;
+  double mean() const { return Count == 0 ? 0 : Sum / Count; }
+};
+
+/// Minimum, maximum and sum of the elements in a single pass. The result is
+/// unspecified for floating point arrays which contain NaN.
+template <typename T> Summary<T> summarize(T const *Data, size_t Count);
+}
+}
@@ -0,0 +1,103 @@
+#include "CURLReporter.h"
+#include "logger.h"
+#if HAVE_CURL
+#include <curl/curl.h>
+#endif
+
+namespace Forwarder {
+
+uint64_t CURLReporter::droppedCount() {
+  std::unique_lock<std::mutex> lock(QueueMutex);
+  return Dropped;
+}
+
+void CURLReporter::enqueue(Message Msg) {
+  std::unique_lock<std::mutex> lock(QueueMutex);
+  if (Queue.size() >= MaxQueueSize) {
+    Queue.pop_front();
+    ++Dropped;
+    CLOG(5, 1, "CURLReporter queue is full, dropped {} messages so far",
+         Dropped);
+  }
+  Queue.push_back(std::move(Msg));
+}
+
+#if HAVE_CURL
+bool const CURLReporter::HaveCURL = true;
+
+CURLReporter::CURLReporter(size_t MaxQueueSize) : MaxQueueSize(MaxQueueSize) {
+  curl_global_init(CURL_GLOBAL_ALL);
+  SenderThread = std::thread([this] { run(); });
+}
+
+CURLReporter::~CURLReporter() {
+  {
+    std::unique_lock<std::mutex> lock(QueueMutex);
+    Running = false;
+  }
+  QueueNotEmpty.notify_all();
+  if (SenderThread.joinable()) {
+    SenderThread.join();
+  }
+  curl_global_cleanup();
+}
+
+void CURLReporter::send(fmt::MemoryWriter &MemoryWriter,
+                        std::string const &URL) {
+  enqueue({URL, MemoryWriter.str()});
+  QueueNotEmpty.notify_one();
+}
+
+void CURLReporter::run() {
+  CURL *curl = curl_easy_init();
+  if (curl == nullptr) {
+    LOG(3, "curl_easy_init() failed, metrics will not be sent");
+  } else {
+    // Reuse the connection between messages and never let a dead endpoint
+    // hold up the queue for long.
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, 2000L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, 5000L);
+  }
+  while (true) {
+    Message Msg;
+    {
+      std::unique_lock<std::mutex> lock(QueueMutex);
+      QueueNotEmpty.wait(lock, [this] { return !Running || !Queue.empty(); });
+      if (!Running) {
+        break;
+      }
+      Msg = std::move(Queue.front());
+      Queue.pop_front();
+    }
+    if (curl == nullptr) {
+      continue;
+    }
+    curl_easy_setopt(curl, CURLOPT_URL, Msg.URL.c_str());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, Msg.Body.c_str());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, long(Msg.Body.size()));
+    auto res = curl_easy_perform(curl);
+    if (res != CURLE_OK) {
+      LOG(5, "curl_easy_perform() failed: {}", curl_easy_strerror(res));
+    }
+  }
+  if (curl != nullptr) {
+    curl_easy_cleanup(curl);
+  }
+}
+
+#else
+bool const CURLReporter::HaveCURL = false;
+
+CURLReporter::CURLReporter(size_t MaxQueueSize) : MaxQueueSize(MaxQueueSize) {}
+
+CURLReporter::~CURLReporter() {}
+
+void CURLReporter::send(fmt::MemoryWriter &MemoryWriter,
+                        std::string const &URL) {}
+
+void CURLReporter::run() {}
+
+#endif
+}
@@ -3,22 +3,37 @@
 #include "helper.h"
 #include "json.h"
 #include "logger.h"
+#include <algorithm>
 #include <nlohmann/json.hpp>
 
 namespace Forwarder {
 
 ConfigCB::ConfigCB(Forwarder &main) : main(main) {}
 
-void ConfigCB::operator()(std::string const &msg) {
-  LOG(7, "Command received: {}", msg);
-  try {
-    handleCommand(msg);
-  } catch (nlohmann::json::parse_error const &e) {
-    LOG(3, "Could not parse command. Command was {}. Exception was: {}", msg,
-        e.what());
-  } catch (...) {
-    LOG(3, "Could not handle command: {}", msg);
+void ConfigCB::operator()(std::string const &msg) { batch({msg}); }
+
+void ConfigCB::batch(std::vector<std::string> const &Messages) {
+  for (auto const &msg : Messages) {
+    LOG(7, "Command received: {}", msg);
+    try {
+      handleCommand(msg);
+    } catch (nlohmann::json::parse_error const &e) {
+      LOG(3, "Could not parse command. Command was {}. Exception was: {}",
+          msg, e.what());
+    } catch (...) {
+      LOG(3, "Could not handle command: {}", msg);
+    }
+  }
+  applyPendingAdds();
+}
+
+void ConfigCB::applyPendingAdds() {
+  if (PendingAdds.empty()) {
+    return;
   }
+  std::vector<StreamSettings> Adds;
+  Adds.swap(PendingAdds);
+  main.addMappings(Adds);
 }
 
 void ConfigCB::handleCommandAdd(nlohmann::json const &Document) {
@@ -27,20 +42,41 @@ void ConfigCB::handleCommandAdd(nlohmann::json const &Document) {
   Config.setJsonFromString(Document.dump());
   auto Settings = Config.extractConfiguration();
 
-  for (auto &Stream : Settings.StreamsInfo) {
-    main.addMapping(Stream);
-  }
+  PendingAdds.insert(PendingAdds.end(), Settings.StreamsInfo.begin(),
+                     Settings.StreamsInfo.end());
+}
+
+void ConfigCB::handleCommandSet(nlohmann::json const &Document) {
+  ConfigParser Config;
+  Config.setJsonFromString(Document.dump());
+  auto Settings = Config.extractConfiguration();
+
+  // The set command replaces everything which was added before it.
+  PendingAdds.clear();
+  main.setMappings(Settings.StreamsInfo);
 }
 
 void ConfigCB::handleCommandStopChannel(nlohmann::json const &Document) {
   if (auto ChannelMaybe = find<std::string>("channel", Document)) {
-    main.streams.channel_stop(ChannelMaybe.inner());
+    auto const &Channel = ChannelMaybe.inner();
+    PendingAdds.erase(std::remove_if(PendingAdds.begin(), PendingAdds.end(),
+                                     [&Channel](StreamSettings const &Add) {
+                                       return Add.Name == Channel;
+                                     }),
+                      PendingAdds.end());
+    main.streams.channel_stop(Channel);
   }
 }
 
-void ConfigCB::handleCommandStopAll() { main.streams.streams_clear(); }
+void ConfigCB::handleCommandStopAll() {
+  PendingAdds.clear();
+  main.streams.streams_clear();
+}
 
-void ConfigCB::handleCommandExit() { main.stopForwarding(); }
+void ConfigCB::handleCommandExit() {
+  applyPendingAdds();
+  main.stopForwarding();
+}
 
 void ConfigCB::handleCommand(std::string const &Msg) {
   using nlohmann::json;
@@ -50,6 +86,8 @@ void ConfigCB::handleCommand(std::string const &Msg) {
 
   if (Command == "add") {
     handleCommandAdd(Document);
+  } else if (Command == "set") {
+    handleCommandSet(Document);
   } else if (Command == "stop_channel") {
     handleCommandStopChannel(Document);
   } else if (Command == "stop_all") {
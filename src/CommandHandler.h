@@ -1,7 +1,9 @@
 #pragma once
 #include "Config.h"
+#include "ConfigParser.h"
 #include "Forwarder.h"
 #include <string>
+#include <vector>
 
 namespace Forwarder {
 
@@ -18,6 +20,14 @@ public:
   /// \param msg The message to handle.
   void operator()(std::string const &msg) override;
 
+  /// Handle the commands of one poll as a single transaction.
+  ///
+  /// Streams added by the batch are created together after all commands
+  /// are handled, unless a later command of the same batch stops them.
+  ///
+  /// \param Messages The messages to handle, in the order they arrived.
+  void batch(std::vector<std::string> const &Messages) override;
+
   /// Extract the command type from the message.
   ///
   /// \param Document The JSON message.
@@ -26,8 +36,12 @@ public:
 
 private:
   Forwarder &main;
+  /// Streams to add at the end of the current batch.
+  std::vector<StreamSettings> PendingAdds;
+  void applyPendingAdds();
   void handleCommand(std::string const &Msg);
   void handleCommandAdd(nlohmann::json const &Document);
+  void handleCommandSet(nlohmann::json const &Document);
   void handleCommandStopChannel(nlohmann::json const &Document);
   void handleCommandStopAll();
   void handleCommandExit();
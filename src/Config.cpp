@@ -35,9 +35,22 @@ Listener::Listener(KafkaW::BrokerSettings BrokerSettings, Forwarder::URI uri) {
 
 Listener::~Listener() {}
 
+size_t const Listener::MaxBatchSize = 1000;
+
 void Listener::poll(Callback &cb) {
-  if (auto m = impl->consumer->poll().isMsg()) {
-    cb({(char *)m->data(), m->size()});
+  std::vector<std::string> Messages;
+  while (true) {
+    auto Batch = impl->consumer->pollBatch(MaxBatchSize);
+    for (auto &m : Batch) {
+      Messages.emplace_back((char *)m->data(), m->size());
+    }
+    if (Batch.size() < MaxBatchSize) {
+      break;
+    }
+  }
+  if (!Messages.empty()) {
+    LOG(7, "Received {} commands", Messages.size());
+    cb.batch(Messages);
   }
 }
 
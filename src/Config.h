@@ -20,6 +20,13 @@ using std::string;
 class Callback {
 public:
   virtual void operator()(string const &msg) = 0;
+  /** Handle all messages received in one poll, in the order they arrived.
+   * By default they are handled one by one. */
+  virtual void batch(std::vector<string> const &Messages) {
+    for (auto const &Message : Messages) {
+      (*this)(Message);
+    }
+  }
 };
 
 struct Listener_impl;
@@ -29,7 +36,10 @@ public:
   Listener(KafkaW::BrokerSettings bopt, URI uri);
   Listener(Listener const &) = delete;
   ~Listener();
+  /// Hands all available messages to the callback as one batch.
   void poll(Callback &cb);
+  /// Maximum number of messages requested from Kafka at once.
+  static size_t const MaxBatchSize;
   void wait_for_connected(std::chrono::milliseconds timeout);
 
 private:
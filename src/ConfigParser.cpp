@@ -3,6 +3,7 @@
 #include "helper.h"
 #include "json.h"
 #include "logger.h"
+#include <algorithm>
 #include <iostream>
 
 namespace Forwarder {
@@ -22,6 +23,8 @@ ConfigSettings ConfigParser::extractConfiguration() {
   extractBrokers(Settings);
   extractConversionThreads(Settings);
   extractConversionWorkerQueueSize(Settings);
+  extractEpicsClientContexts(Settings);
+  extractNativeCA(Settings);
   extractMainPollInterval(Settings);
   extractStatusUri(Settings);
   extractKafkaBrokerSettings(Settings);
@@ -58,6 +61,18 @@ void ConfigParser::extractConversionWorkerQueueSize(ConfigSettings &Settings) {
   }
 }
 
+void ConfigParser::extractEpicsClientContexts(ConfigSettings &Settings) {
+  if (auto x = find<size_t>("epics-client-contexts", Json)) {
+    Settings.EpicsClientContexts = std::max<size_t>(1, x.inner());
+  }
+}
+
+void ConfigParser::extractNativeCA(ConfigSettings &Settings) {
+  if (auto x = find<bool>("native-ca", Json)) {
+    Settings.NativeCA = x.inner();
+  }
+}
+
 void ConfigParser::extractMainPollInterval(ConfigSettings &Settings) {
   if (auto x = find<int32_t>("main-poll-interval", Json)) {
     Settings.MainPollInterval = x.inner();
@@ -151,6 +166,10 @@ void ConfigParser::extractStreamSettings(ConfigSettings &Settings) {
         StreamSettings Stream;
         // Find the basic information
         extractMappingInfo(StreamJson, Stream.Name, Stream.EpicsProtocol);
+        Stream.Monitor = extractMonitorSettings(StreamJson);
+        if (auto x = find<uint32_t>("pv_update_period", StreamJson)) {
+          Stream.PVUpdatePeriodMS = x.inner();
+        }
 
         // Find the converters, if present
         if (auto x = find<nlohmann::json>("converter", StreamJson)) {
@@ -218,4 +237,23 @@ ConfigParser::extractConverterSettings(nlohmann::json const &Mapping) {
   return Settings;
 }
 
+MonitorSettings
+ConfigParser::extractMonitorSettings(nlohmann::json const &Mapping) {
+  MonitorSettings Settings;
+
+  if (auto x = find<uint32_t>("monitor_queue_size", Mapping)) {
+    Settings.QueueSize = x.inner();
+  }
+
+  if (auto x = find<bool>("monitor_pipeline", Mapping)) {
+    Settings.Pipeline = x.inner();
+  }
+
+  if (auto x = find<std::vector<std::string>>("monitor_fields", Mapping)) {
+    Settings.Fields = x.inner();
+  }
+
+  return Settings;
+}
+
 } // namespace Forwarder
@@ -23,11 +23,26 @@ struct ConverterSettings {
   std::string Name;
 };
 
+/// Holder for the options of the EPICS monitor of a stream.
+struct MonitorSettings {
+  /// Size of the monitor queue on the server. 0 uses the server default.
+  uint32_t QueueSize = 0;
+  /// Use pvAccess flow control, where the server only sends as many updates
+  /// as the client has acknowledged. Updates are acknowledged when they are
+  /// copied into the emit queue, so this does not cover the conversion.
+  bool Pipeline = false;
+  /// The fields to request. Empty requests value, timeStamp and alarm.
+  std::vector<std::string> Fields;
+};
+
 /// Holder for the stream settings defined in the configuration file.
 struct StreamSettings {
   std::string Name;
   std::string EpicsProtocol;
   std::vector<ConverterSettings> Converters;
+  MonitorSettings Monitor;
+  /// Period to forward the last value again, 0 uses --pv-update-period.
+  uint32_t PVUpdatePeriodMS = 0;
 };
 
 /// Holder for the configuration settings defined in the configuration file.
@@ -36,6 +51,8 @@ struct ConfigSettings {
   std::vector<URI> Brokers;
   size_t ConversionThreads{1};
   size_t ConversionWorkerQueueSize{1024};
+  size_t EpicsClientContexts{1};
+  bool NativeCA{false};
   int32_t MainPollInterval{500};
   URI StatusReportURI;
   KafkaBrokerSettings BrokerSettings;
@@ -70,10 +87,13 @@ private:
   void extractMappingInfo(nlohmann::json const &Mapping, std::string &Channel,
                           std::string &Protocol);
   ConverterSettings extractConverterSettings(nlohmann::json const &Mapping);
+  MonitorSettings extractMonitorSettings(nlohmann::json const &Mapping);
   void extractBrokerConfig(ConfigSettings &Settings);
   void extractBrokers(ConfigSettings &Settings);
   void extractConversionThreads(ConfigSettings &Settings);
   void extractConversionWorkerQueueSize(ConfigSettings &Settings);
+  void extractEpicsClientContexts(ConfigSettings &Settings);
+  void extractNativeCA(ConfigSettings &Settings);
   void extractMainPollInterval(ConfigSettings &Settings);
   void extractStatusUri(ConfigSettings &Settings);
   void extractKafkaBrokerSettings(ConfigSettings &Settings);
@@ -31,6 +31,7 @@ int ConversionWorker::run() {
   auto Dt = MS(100);
   auto t1 = CLK::now();
   while (do_run) {
+    scheduler->runPeriodicUpdates();
     auto qs = queue.size_approx();
     if (qs == 0) {
       auto qf = queue.MAX_SUBQUEUE_SIZE - qs;
@@ -62,25 +63,27 @@ int ConversionScheduler::fill(
     moodycamel::ConcurrentQueue<std::unique_ptr<ConversionWorkPacket>> &queue,
     uint32_t const nfm, uint32_t wid) {
   std::unique_lock<std::mutex> lock(mx);
-  if (main->streams.size() == 0) {
+  // Work on a snapshot, so that adding and stopping streams never waits for
+  // the conversion workers and vice versa.
+  auto Streams = main->streams.snapshot();
+  if (Streams->empty()) {
     return 0;
   }
-  auto lock_streams = main->get_lock_streams();
   uint32_t nfc = 0;
-  if (sid >= main->streams.size()) {
+  if (sid >= Streams->size()) {
     sid = 0;
   }
   auto sid0 = sid;
   while (nfc < nfm) {
     auto track_seq_data = [&](uint64_t seq_data) {};
-    auto n1 = main->streams[sid]->fill_conversion_work(queue, nfm - nfc,
-                                                       track_seq_data);
+    auto n1 = (*Streams)[sid]->fill_conversion_work(queue, nfm - nfc,
+                                                    track_seq_data);
     if (n1 > 0) {
       CLOG(7, 3, "Give worker {:2}  items: {:3}  stream: {:3}", wid, n1, sid);
     }
     nfc += n1;
     sid += 1;
-    if (sid >= main->streams.size()) {
+    if (sid >= Streams->size()) {
       sid = 0;
     }
     if (sid == sid0)
@@ -89,6 +92,14 @@ int ConversionScheduler::fill(
   return nfc;
 }
 
+size_t ConversionScheduler::runPeriodicUpdates() {
+  // Each worker runs at most this many per iteration, so that a large sweep
+  // is shared by all workers.
+  size_t const MaxPerWorker = 1000;
+  main->PeriodicUpdates.advance(std::chrono::steady_clock::now());
+  return main->PeriodicUpdates.runDue(MaxPerWorker);
+}
+
 ConversionScheduler::~ConversionScheduler() {
   LOG(6, "~ConversionScheduler  seq_data_enqueued {}",
       seq_data_enqueued.to_string());
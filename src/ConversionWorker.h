@@ -45,6 +45,8 @@ public:
   int fill(
       moodycamel::ConcurrentQueue<std::unique_ptr<ConversionWorkPacket>> &queue,
       uint32_t nfm, uint32_t wid);
+  /// Sweeps the periodic updates and runs a share of the due ones.
+  size_t runPeriodicUpdates();
 
 private:
   Forwarder *main = nullptr;
@@ -35,6 +35,11 @@ Converter::convert(FlatBufs::EpicsPVUpdate const &up) {
   return conv->convert(up);
 }
 
+FlatBufs::FlatbufferMessage::uptr
+Converter::convert(FlatBufs::EpicsPVUpdate const &up, uint32_t InitialSize) {
+  return conv->convertWithSizeHint(up, InitialSize);
+}
+
 std::map<std::string, double> Converter::stats() { return conv->stats(); }
 
 std::string Converter::schema_name() const { return schema; }
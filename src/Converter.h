@@ -16,6 +16,9 @@ public:
   static sptr create(FlatBufs::SchemaRegistry const &schema_registry,
                      std::string schema, MainOpt const &main_opt);
   FlatBufs::FlatbufferMessage::uptr convert(FlatBufs::EpicsPVUpdate const &up);
+  /// Converts into a builder which starts with InitialSize bytes.
+  FlatBufs::FlatbufferMessage::uptr convert(FlatBufs::EpicsPVUpdate const &up,
+                                            uint32_t InitialSize);
   std::map<std::string, double> stats();
   std::string schema_name() const;
 
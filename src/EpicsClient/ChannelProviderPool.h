@@ -0,0 +1,16 @@
+#pragma once
+#include <pv/pvAccess.h>
+#include <string>
+
+namespace Forwarder {
+namespace EpicsClient {
+
+/// Returns the channel provider of the given type which serves the channel.
+/// With more than one context, each channel name is always assigned to the
+/// same of the independent providers by its hash. Must only be used while an
+/// EpicsClientFactoryInit instance exists.
+epics::pvAccess::ChannelProvider::shared_pointer
+getChannelProvider(std::string const &ProviderType,
+                   std::string const &ChannelName);
+}
+}
@@ -0,0 +1,368 @@
+#include "EpicsClientCA.h"
+#include "EpicsClientFactory.h"
+#include "EpicsPVUpdate.h"
+#include "logger.h"
+#include <alarm.h>
+#include <algorithm>
+#include <cadef.h>
+#include <chrono>
+#include <epicsTime.h>
+#include <functional>
+#include <mutex>
+#include <pv/pvData.h>
+#include <pv/standardField.h>
+#include <utility>
+#include <vector>
+
+namespace Forwarder {
+namespace EpicsClient {
+
+using epics::pvData::PVStructure;
+using epics::pvData::ScalarType;
+using ulock = std::unique_lock<std::mutex>;
+
+/// Makes the given CA client context current for the lifetime of the scope
+/// and restores the previous one afterwards.
+class CAContextScope {
+public:
+  explicit CAContextScope(ca_client_context *Context)
+      : Previous(ca_current_context()) {
+    if (Previous != Context) {
+      if (Previous != nullptr) {
+        ca_detach_context();
+      }
+      ca_attach_context(Context);
+    }
+  }
+  ~CAContextScope() {
+    if (ca_current_context() != Previous) {
+      ca_detach_context();
+      if (Previous != nullptr) {
+        ca_attach_context(Previous);
+      }
+    }
+  }
+
+private:
+  ca_client_context *Previous;
+};
+
+/// Returns the CA client context for the channel. The contexts are created
+/// on first use, one per configured EPICS client context, and live until the
+/// end of the process.
+static ca_client_context *contextForChannel(std::string const &ChannelName) {
+  static std::mutex Mutex;
+  static std::vector<ca_client_context *> Contexts;
+  ulock lock(Mutex);
+  auto Count = EpicsClientFactoryInit::contextCount();
+  while (Contexts.size() < Count) {
+    auto Previous = ca_current_context();
+    if (Previous != nullptr) {
+      ca_detach_context();
+    }
+    auto Status = ca_context_create(ca_enable_preemptive_callback);
+    auto Context = ca_current_context();
+    if (Status != ECA_NORMAL || Context == nullptr) {
+      if (Previous != nullptr) {
+        ca_attach_context(Previous);
+      }
+      throw std::runtime_error(fmt::format("can not create CA context: {}",
+                                           ca_message(Status)));
+    }
+    ca_detach_context();
+    if (Previous != nullptr) {
+      ca_attach_context(Previous);
+    }
+    Contexts.push_back(Context);
+    CLOG(6, 6, "Created CA client context {}", Contexts.size());
+  }
+  return Contexts[std::hash<std::string>()(ChannelName) % Count];
+}
+
+static ScalarType scalarTypeForDBF(short FieldType) {
+  switch (FieldType) {
+  case DBF_STRING:
+    return ScalarType::pvString;
+  case DBF_SHORT:
+  case DBF_ENUM:
+    return ScalarType::pvShort;
+  case DBF_FLOAT:
+    return ScalarType::pvFloat;
+  case DBF_CHAR:
+    return ScalarType::pvByte;
+  case DBF_LONG:
+    return ScalarType::pvInt;
+  case DBF_DOUBLE:
+  default:
+    return ScalarType::pvDouble;
+  }
+}
+
+/// Copies the value of a DBR buffer into the value field.
+template <typename CAType, typename PVType>
+static void putValue(PVStructure &Update, void const *Value, long Count,
+                     bool IsArray) {
+  auto Values = static_cast<CAType const *>(Value);
+  if (IsArray) {
+    epics::pvData::shared_vector<PVType> Array(Count);
+    std::copy(Values, Values + Count, Array.begin());
+    Update.getSubFieldT<epics::pvData::PVScalarArray>("value")
+        ->putFrom<PVType>(epics::pvData::freeze(Array));
+  } else {
+    Update.getSubFieldT<epics::pvData::PVScalar>("value")->putFrom<PVType>(
+        static_cast<PVType>(Values[0]));
+  }
+}
+
+static void putStringValue(PVStructure &Update, void const *Value, long Count,
+                           bool IsArray) {
+  auto Values = static_cast<dbr_string_t const *>(Value);
+  if (IsArray) {
+    epics::pvData::shared_vector<std::string> Array(Count);
+    for (long i = 0; i < Count; ++i) {
+      Array[i] = Values[i];
+    }
+    Update.getSubFieldT<epics::pvData::PVStringArray>("value")->replace(
+        epics::pvData::freeze(Array));
+  } else {
+    Update.getSubFieldT<epics::pvData::PVString>("value")->put(Values[0]);
+  }
+}
+
+/// Implementation for the native Channel Access client.
+class EpicsClientCA_impl {
+public:
+  explicit EpicsClientCA_impl(EpicsClientInterface *epics_client)
+      : epics_client(epics_client) {}
+
+  ~EpicsClientCA_impl() { stop(); }
+
+  /// Creates the channel. The subscription is created once the channel
+  /// connects and its native type is known.
+  int init(std::string const &ChannelName) {
+    channel_name = ChannelName;
+    Context = contextForChannel(ChannelName);
+    CAContextScope Scope(Context);
+    auto Status =
+        ca_create_channel(channel_name.c_str(), &connectionHandler, this,
+                          CA_PRIORITY_DEFAULT, &Channel);
+    if (Status != ECA_NORMAL) {
+      CLOG(3, 1, "Can not create CA channel {}: {}", channel_name,
+           ca_message(Status));
+      Channel = nullptr;
+      return 1;
+    }
+    ca_flush_io();
+    return 0;
+  }
+
+  /// Clears the subscription and the channel. libca waits for callbacks
+  /// which are in progress, so no callback arrives afterwards.
+  /// The connection handler runs under the callback mutex of libca and then
+  /// takes SubscriptionMutex, so libca must not be called with
+  /// SubscriptionMutex held.
+  int stop() {
+    ulock lock(StopMutex);
+    if (Channel == nullptr) {
+      return 0;
+    }
+    CAContextScope Scope(Context);
+    evid OldSubscription = nullptr;
+    {
+      ulock SubscriptionLock(SubscriptionMutex);
+      Stopping = true;
+      std::swap(OldSubscription, Subscription);
+    }
+    if (OldSubscription != nullptr) {
+      ca_clear_subscription(OldSubscription);
+    }
+    ca_clear_channel(Channel);
+    Channel = nullptr;
+    ca_flush_io();
+    Connected = false;
+    return 0;
+  }
+
+  static void connectionHandler(connection_handler_args Args) {
+    auto Self = static_cast<EpicsClientCA_impl *>(ca_puser(Args.chid));
+    if (Args.op == CA_OP_CONN_UP) {
+      Self->connectionUp(Args.chid);
+    } else {
+      LOG(4, "CA channel {} disconnected", Self->channel_name);
+      Self->Connected = false;
+    }
+  }
+
+  void connectionUp(chid Channel) {
+    CLOG(7, 7, "CA channel {} connected", channel_name);
+    Connected = true;
+    IsArray = ca_element_count(Channel) > 1;
+    ulock lock(SubscriptionMutex);
+    if (Stopping || Subscription != nullptr) {
+      // libca restores the subscription after a reconnect.
+      return;
+    }
+    // Count 0 asks the server for the current number of elements.
+    auto Status = ca_create_subscription(
+        dbf_type_to_DBR_TIME(ca_field_type(Channel)), 0, Channel,
+        DBE_VALUE | DBE_ALARM, &eventHandler, this, &Subscription);
+    if (Status != ECA_NORMAL) {
+      CLOG(3, 2, "Can not subscribe to CA channel {}: {}", channel_name,
+           ca_message(Status));
+      Subscription = nullptr;
+      epics_client->errorInEpics();
+    }
+    ca_flush_io();
+  }
+
+  static void eventHandler(event_handler_args Args) {
+    auto Self = static_cast<EpicsClientCA_impl *>(Args.usr);
+    if (Args.status != ECA_NORMAL || Args.dbr == nullptr) {
+      LOG_LIMITED(5, "CA event error on {}: {}", Self->channel_name,
+                  ca_message(Args.status));
+      return;
+    }
+    Self->event(Args);
+  }
+
+  /// Decodes the DBR_TIME_* buffer into a new update and emits it.
+  void event(event_handler_args const &Args) {
+    uint64_t ts = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::system_clock::now().time_since_epoch())
+                      .count();
+    bool Array = IsArray.load() || Args.count > 1;
+    auto Update = std::make_shared<FlatBufs::EpicsPVUpdate>();
+    Update->epics_pvstr = epics::pvData::getPVDataCreate()->createPVStructure(
+        structureFor(Args.type, Array));
+    auto &PV = *Update->epics_pvstr;
+    auto Value = dbr_value_ptr(Args.dbr, Args.type);
+    switch (Args.type) {
+    case DBR_TIME_STRING:
+      putStringValue(PV, Value, Args.count, Array);
+      break;
+    case DBR_TIME_SHORT:
+      putValue<dbr_short_t, int16_t>(PV, Value, Args.count, Array);
+      break;
+    case DBR_TIME_FLOAT:
+      putValue<dbr_float_t, float>(PV, Value, Args.count, Array);
+      break;
+    case DBR_TIME_ENUM:
+      putValue<dbr_enum_t, int16_t>(PV, Value, Args.count, Array);
+      break;
+    case DBR_TIME_CHAR:
+      putValue<dbr_char_t, int8_t>(PV, Value, Args.count, Array);
+      break;
+    case DBR_TIME_LONG:
+      putValue<dbr_long_t, int32_t>(PV, Value, Args.count, Array);
+      break;
+    case DBR_TIME_DOUBLE:
+      putValue<dbr_double_t, double>(PV, Value, Args.count, Array);
+      break;
+    default:
+      LOG_LIMITED(4, "Unsupported DBR type {} on {}", Args.type,
+                  channel_name);
+      return;
+    }
+    // All DBR_TIME_* types share the layout of status, severity and stamp.
+    auto Header = static_cast<dbr_time_short const *>(Args.dbr);
+    PV.getSubFieldT<epics::pvData::PVInt>("alarm.severity")
+        ->put(Header->severity);
+    PV.getSubFieldT<epics::pvData::PVInt>("alarm.status")
+        ->put(Header->status == NO_ALARM ? 0 : 3);
+    if (Header->status > NO_ALARM && Header->status < ALARM_NSTATUS) {
+      PV.getSubFieldT<epics::pvData::PVString>("alarm.message")
+          ->put(epicsAlarmConditionStrings[Header->status]);
+    }
+    PV.getSubFieldT<epics::pvData::PVLong>("timeStamp.secondsPastEpoch")
+        ->put(static_cast<int64_t>(Header->stamp.secPastEpoch) +
+              POSIX_TIME_AT_EPICS_EPOCH);
+    PV.getSubFieldT<epics::pvData::PVInt>("timeStamp.nanoseconds")
+        ->put(Header->stamp.nsec);
+    Update->channel = channel_name;
+    Update->seq_fwd = seq++;
+    Update->ts_epics_monitor = ts;
+    if (epics_client->emit(Update) != 0) {
+      LOG_LIMITED(5, "error can not push update {}", Update->seq_fwd);
+    }
+  }
+
+  /// Returns the pvData structure for updates of the given type. It is only
+  /// rebuilt when the type changes.
+  epics::pvData::StructureConstPtr structureFor(long Type, bool Array) {
+    ulock lock(StructureMutex);
+    if (!Structure || Type != StructureType || Array != StructureIsArray) {
+      auto PVType = scalarTypeForDBF(static_cast<short>(dbr_type_to_DBF(Type)));
+      auto StandardField = epics::pvData::getStandardField();
+      Structure = Array ? StandardField->scalarArray(PVType, "alarm,timeStamp")
+                        : StandardField->scalar(PVType, "alarm,timeStamp");
+      StructureType = Type;
+      StructureIsArray = Array;
+    }
+    return Structure;
+  }
+
+  std::string channel_name;
+  std::atomic<bool> Connected{false};
+  std::atomic<bool> IsArray{false};
+
+private:
+  EpicsClientInterface *epics_client = nullptr;
+  ca_client_context *Context = nullptr;
+  chid Channel = nullptr;
+  evid Subscription = nullptr;
+  std::mutex StopMutex;
+  /// Guards the subscription against a concurrent connection callback.
+  std::mutex SubscriptionMutex;
+  bool Stopping = false;
+  std::mutex StructureMutex;
+  epics::pvData::StructureConstPtr Structure;
+  long StructureType = -1;
+  bool StructureIsArray = false;
+  uint64_t seq = 0;
+};
+
+EpicsClientCA::EpicsClientCA(
+    ChannelInfo &ChannelInfo,
+    std::shared_ptr<
+        moodycamel::ConcurrentQueue<std::shared_ptr<FlatBufs::EpicsPVUpdate>>>
+        Ring)
+    : EmitQueue(Ring) {
+  Impl.reset(new EpicsClientCA_impl(this));
+  CLOG(7, 7, "native CA channel_name: {}", ChannelInfo.channel_name);
+  if (Impl->init(ChannelInfo.channel_name) != 0) {
+    Impl.reset();
+    throw std::runtime_error("could not initialize");
+  }
+}
+
+EpicsClientCA::~EpicsClientCA() {
+  CLOG(7, 6, "~EpicsClientCA");
+  // No callback may use the emit queue after it is destroyed.
+  Impl->stop();
+}
+
+int EpicsClientCA::stop() { return Impl->stop(); }
+
+int EpicsClientCA::emit(std::shared_ptr<FlatBufs::EpicsPVUpdate> Update) {
+  if (!Update) {
+    LOG_LIMITED(6, "empty update?");
+    return 1;
+  }
+  std::atomic_store(&CachedUpdate, Update);
+  if (!EmitQueue->enqueue(Update)) {
+    // Only fails if the queue can not allocate memory.
+    return 1;
+  }
+  return 0;
+}
+
+bool EpicsClientCA::connected() { return Impl && Impl->Connected; }
+
+void EpicsClientCA::emitCachedValue() {
+  if (auto Update = std::atomic_load(&CachedUpdate)) {
+    Update->Repeated = true;
+    EmitQueue->enqueue(Update);
+  }
+}
+}
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "EpicsClientInterface.h"
+#include "Stream.h"
+#include <atomic>
+#include <memory>
+#include <string>
+
+///\file Epics client which talks Channel Access directly via libca (PIMPL
+/// idiom avoids exposing cadef.h to other parts of the codebase)
+
+namespace Forwarder {
+namespace EpicsClient {
+
+class EpicsClientCA_impl;
+
+/// Epics client implementation which monitors a Channel Access PV without
+/// going through the pvAccess CA provider.
+///
+/// The DBR_TIME_* buffers from libca are decoded directly into the pvData
+/// structure of the update, the same way the CA provider represents them:
+/// value, alarm and timeStamp relative to the POSIX epoch. Enums are
+/// forwarded as their index.
+class EpicsClientCA : public EpicsClientInterface {
+public:
+  explicit EpicsClientCA(
+      ChannelInfo &ChannelInfo,
+      std::shared_ptr<
+          moodycamel::ConcurrentQueue<std::shared_ptr<FlatBufs::EpicsPVUpdate>>>
+          Ring);
+  ~EpicsClientCA() override;
+
+  /// Pushes the PV update onto the emit_queue ring buffer.
+  ///
+  /// \return 0 on success, nonzero if the update could not be queued.
+  int emit(std::shared_ptr<FlatBufs::EpicsPVUpdate> Update) override;
+
+  /// Clears the subscription and the channel.
+  int stop() override;
+
+  void errorInEpics() override { status_ = -1; }
+
+  int status() override { return status_; }
+
+  bool connected() override;
+
+  void emitCachedValue() override;
+
+private:
+  std::unique_ptr<EpicsClientCA_impl> Impl;
+  std::shared_ptr<
+      moodycamel::ConcurrentQueue<std::shared_ptr<FlatBufs::EpicsPVUpdate>>>
+      EmitQueue;
+  /// Only accessed through std::atomic_load and std::atomic_store.
+  std::shared_ptr<FlatBufs::EpicsPVUpdate> CachedUpdate;
+  std::atomic<int> status_{0};
+};
+}
+}
@@ -1,6 +1,11 @@
 #include "EpicsClientFactory.h"
+#include "ChannelProviderPool.h"
 #include "helper.h"
 #include "logger.h"
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <vector>
 // For epics::pvAccess::ClientFactory::start()
 #include <pv/caProvider.h>
 #include <pv/clientFactory.h>
@@ -15,6 +20,48 @@ std::atomic<int> EpicsClientFactoryInit::Count{0};
 
 std::mutex EpicsClientFactoryInit::MutexLock;
 
+using ProviderPtr = epics::pvAccess::ChannelProvider::shared_pointer;
+
+static std::atomic<size_t> ContextCount{1};
+
+/// Independent providers per provider type. Guarded by ProvidersMutex.
+static std::map<std::string, std::vector<ProviderPtr>> Providers;
+
+static std::mutex ProvidersMutex;
+
+void EpicsClientFactoryInit::setContextCount(size_t Count) {
+  ContextCount = std::max<size_t>(1, Count);
+}
+
+size_t EpicsClientFactoryInit::contextCount() { return ContextCount.load(); }
+
+ProviderPtr getChannelProvider(std::string const &ProviderType,
+                               std::string const &ChannelName) {
+  auto Registry = ::epics::pvAccess::getChannelProviderRegistry();
+  auto Count = ContextCount.load();
+  if (Count <= 1) {
+    return Registry->getProvider(ProviderType);
+  }
+  ulock lock(ProvidersMutex);
+  auto &Pool = Providers[ProviderType];
+  if (Pool.size() != Count) {
+    Pool.clear();
+    for (size_t i = 0; i < Count; ++i) {
+      // Each created provider has its own client context and threads.
+      auto Provider = Registry->createProvider(ProviderType);
+      if (!Provider) {
+        LOG(4, "Can not create provider {}, using the shared one",
+            ProviderType);
+        Pool.clear();
+        return Registry->getProvider(ProviderType);
+      }
+      Pool.push_back(Provider);
+    }
+    CLOG(6, 6, "Created {} {} client contexts", Count, ProviderType);
+  }
+  return Pool[std::hash<std::string>()(ChannelName) % Pool.size()];
+}
+
 std::unique_ptr<EpicsClientFactoryInit> EpicsClientFactoryInit::factory_init() {
   return ::make_unique<EpicsClientFactoryInit>();
 }
@@ -42,6 +89,10 @@ EpicsClientFactoryInit::~EpicsClientFactoryInit() {
   }
   if (c == 0) {
     CLOG(7, 6, "STOP   Epics factories");
+    {
+      ulock ProvidersLock(ProvidersMutex);
+      Providers.clear();
+    }
     ::epics::pvAccess::ClientFactory::stop();
     ::epics::pvAccess::ca::CAClientFactory::stop();
   }
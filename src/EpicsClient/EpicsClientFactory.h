@@ -1,5 +1,6 @@
 #pragma once
 #include <atomic>
+#include <cstddef>
 #include <memory>
 #include <mutex>
 
@@ -14,6 +15,13 @@ struct EpicsClientFactoryInit {
 
   /// Returns a new instance of the EPICS client factory.
   static std::unique_ptr<EpicsClientFactoryInit> factory_init();
+
+  /// Sets the number of independent client contexts per provider type.
+  /// Channels are spread over the contexts, so that the network I/O and the
+  /// monitor callbacks of many channels run on the threads of all contexts.
+  /// Applies to channels created afterwards.
+  static void setContextCount(size_t Count);
+  static size_t contextCount();
   static std::atomic<int> Count;
   static std::mutex MutexLock;
 };
@@ -13,6 +13,10 @@ public:
   virtual int stop() = 0;
   virtual void errorInEpics() = 0;
   virtual int status() = 0;
+  /// Whether the channel is currently connected.
+  virtual bool connected() { return true; }
+  /// Emits the last update again, used to forward PVs periodically.
+  virtual void emitCachedValue() {}
 };
 }
 }
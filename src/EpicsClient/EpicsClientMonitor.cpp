@@ -1,4 +1,5 @@
 #include "EpicsClientMonitor.h"
+#include "ChannelProviderPool.h"
 #include "ChannelRequester.h"
 #include "FwdMonitorRequester.h"
 #include <atomic>
@@ -38,8 +39,7 @@ public:
     factory_init = EpicsClientFactoryInit::factory_init();
     {
       RLOCK();
-      provider = ::epics::pvAccess::getChannelProviderRegistry()->getProvider(
-          epics_channel_provider_type);
+      provider = getChannelProvider(epics_channel_provider_type, channel_name);
       if (!provider) {
         CLOG(3, 1, "Can not initialize provider");
         return 1;
@@ -58,15 +58,13 @@ public:
       LOG(7, "monitoringStart:  want to start but we have no channel");
       return -1;
     }
-    LOG(7, "monitoringStart");
-    // Leaving it empty seems to be the full channel, including name.  That's
-    // good.
-    // Can also specify subfields, e.g. "value, timeStamp"  or also
-    // "field(value)"
-    // We need to be more explicit here for compatibility with channel access.
-    std::string request = "field(value,timeStamp,alarm)";
+    LOG(7, "monitoringStart  request: {}", request);
     PVStructure::shared_pointer pvreq =
         epics::pvData::CreateRequest::create()->createRequest(request);
+    if (!pvreq) {
+      CLOG(3, 1, "invalid monitor request for {}: {}", channel_name, request);
+      return -2;
+    }
     if (monitor) {
       monitoringStop();
     }
@@ -136,11 +134,43 @@ public:
   epics::pvAccess::Channel::shared_pointer channel;
   epics::pvData::Monitor::shared_pointer monitor;
   std::recursive_mutex mx;
+  std::atomic<bool> Connected{false};
   std::string channel_name;
+  /// The pvRequest used for the monitor.
+  std::string request;
   EpicsClientInterface *epics_client = nullptr;
   std::unique_ptr<EpicsClientFactoryInit> factory_init;
 };
 
+std::string monitorRequestString(MonitorSettings const &Settings) {
+  // We need to be explicit about the fields for compatibility with channel
+  // access.
+  std::string Fields = "value,timeStamp,alarm";
+  if (!Settings.Fields.empty()) {
+    Fields.clear();
+    for (auto const &Field : Settings.Fields) {
+      if (!Fields.empty()) {
+        Fields += ",";
+      }
+      Fields += Field;
+    }
+  }
+  std::string Options;
+  if (Settings.QueueSize > 0) {
+    Options = fmt::format("queueSize={}", Settings.QueueSize);
+  }
+  if (Settings.Pipeline) {
+    // Acknowledgements are sent by pvAccess as elements are released, which
+    // FwdMonitorRequester does right after copying them. The flow control
+    // therefore only covers the client queue, not the emit queue.
+    Options += Options.empty() ? "pipeline=true" : ",pipeline=true";
+  }
+  if (Options.empty()) {
+    return fmt::format("field({})", Fields);
+  }
+  return fmt::format("record[{}]field({})", Options, Fields);
+}
+
 EpicsClientMonitor::EpicsClientMonitor(
     ChannelInfo &ChannelInfo,
     std::shared_ptr<
@@ -150,6 +180,7 @@ EpicsClientMonitor::EpicsClientMonitor(
   Impl.reset(new EpicsClientMonitor_impl(this));
   CLOG(7, 7, "channel_name: {}", ChannelInfo.channel_name);
   Impl->channel_name = ChannelInfo.channel_name;
+  Impl->request = monitorRequestString(ChannelInfo.Monitor);
   if (Impl->init(ChannelInfo.provider_type) != 0) {
     Impl.reset();
     throw std::runtime_error("could not initialize");
@@ -163,21 +194,24 @@ EpicsClientMonitor::~EpicsClientMonitor() {
 int EpicsClientMonitor::stop() { return Impl->stop(); }
 
 int EpicsClientMonitor::emit(std::shared_ptr<FlatBufs::EpicsPVUpdate> Update) {
-  CachedUpdate = Update;
+  std::atomic_store(&CachedUpdate, Update);
   return emitWithoutCaching(Update);
 }
 
 void EpicsClientMonitor::errorInEpics() { status_ = -1; }
 
+bool EpicsClientMonitor::connected() { return Impl && Impl->Connected; }
+
 void EpicsClientMonitor::emitCachedValue() {
-  if (CachedUpdate != nullptr) {
-    emitWithoutCaching(CachedUpdate);
+  if (auto Update = std::atomic_load(&CachedUpdate)) {
+    Update->Repeated = true;
+    emitWithoutCaching(Update);
   }
 }
 int EpicsClientMonitor::emitWithoutCaching(
     std::shared_ptr<FlatBufs::EpicsPVUpdate> Update) {
   if (!Update) {
-    CLOG(6, 1, "empty update?");
+    LOG_LIMITED(6, "empty update?");
     // should never happen, ignore
     return 1;
   }
@@ -260,6 +294,7 @@ void ChannelRequester::channelStateChange(
   }
   if (ConnectionState == Channel::CONNECTED) {
     CLOG(7, 7, "Epics channel connected");
+    EpicsClientImpl->Connected = true;
     if (log_level >= 9) {
       LOG(9, "ChannelRequester::channelStateChange  channelinfo: {}",
           channelInfo(Channel));
@@ -267,9 +302,11 @@ void ChannelRequester::channelStateChange(
     EpicsClientImpl->monitoringStart();
   } else if (ConnectionState == Channel::DISCONNECTED) {
     CLOG(7, 6, "Epics channel disconnect");
+    EpicsClientImpl->Connected = false;
     EpicsClientImpl->monitoringStop();
   } else if (ConnectionState == Channel::DESTROYED) {
     CLOG(7, 6, "Epics channel destroyed");
+    EpicsClientImpl->Connected = false;
     EpicsClientImpl->channelDestroyed();
   } else {
     CLOG(3, 3, "Unhandled channel state change: {} {}", ConnectionState,
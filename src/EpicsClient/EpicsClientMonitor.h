@@ -18,6 +18,10 @@ using std::vector;
 
 class EpicsClientMonitor_impl;
 
+/// Builds the pvRequest string for a monitor with the given options, e.g.
+/// "record[queueSize=8,pipeline=true]field(value,timeStamp,alarm)".
+std::string monitorRequestString(MonitorSettings const &Settings);
+
 /// Epics client implementation which monitors for PV updates.
 class EpicsClientMonitor : public EpicsClientInterface {
 public:
@@ -46,13 +50,18 @@ public:
   /// Getter method for EPICS status.
   int status() override { return status_; };
 
-  void emitCachedValue();
+  /// Whether the EPICS channel is currently connected.
+  bool connected() override;
+
+  void emitCachedValue() override;
 
 private:
   std::unique_ptr<EpicsClientMonitor_impl> Impl;
   std::shared_ptr<
       moodycamel::ConcurrentQueue<std::shared_ptr<FlatBufs::EpicsPVUpdate>>>
       EmitQueue;
+  /// Only accessed through std::atomic_load and std::atomic_store, because
+  /// the periodic updates run on the conversion workers.
   std::shared_ptr<FlatBufs::EpicsPVUpdate> CachedUpdate;
   std::atomic<int> status_{0};
 };
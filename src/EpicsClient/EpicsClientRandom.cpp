@@ -1,11 +1,64 @@
 #include "EpicsClientRandom.h"
 #include "pv/pvData.h"
+#include "pv/standardField.h"
+#include "pv/typeCast.h"
+#include <algorithm>
+#include <fmt/format.h>
 #include <helper.h>
 #include <memory>
+#include <stdexcept>
 
 namespace Forwarder {
 namespace EpicsClient {
 
+namespace pvd = epics::pvData;
+
+FakePVArrival parseFakePVArrival(std::string const &Name) {
+  if (Name == "periodic") {
+    return FakePVArrival::Periodic;
+  }
+  if (Name == "poisson") {
+    return FakePVArrival::Poisson;
+  }
+  if (Name == "bursty") {
+    return FakePVArrival::Bursty;
+  }
+  throw std::runtime_error(
+      fmt::format("Unknown arrival pattern of fake PVs: {}", Name));
+}
+
+EpicsClientRandom::EpicsClientRandom(
+    ChannelInfo &channelInfo,
+    std::shared_ptr<
+        moodycamel::ConcurrentQueue<std::shared_ptr<FlatBufs::EpicsPVUpdate>>>
+        RingBuffer)
+    : ChannelInformation(channelInfo), EmitQueue(RingBuffer),
+      UniformDistribution(0, 100) {
+  setSettings(Settings);
+}
+
+void EpicsClientRandom::setSettings(FakePVSettings const &NewSettings) {
+  Settings = NewSettings;
+  Type = pvd::ScalarTypeFunc::getScalarType(Settings.Type);
+  auto StandardField = pvd::getStandardField();
+  if (Settings.ArraySize == 0) {
+    Structure = StandardField->scalar(Type, "alarm,timeStamp");
+  } else {
+    Structure = StandardField->scalarArray(Type, "alarm,timeStamp");
+  }
+  auto Prototype = pvd::getPVDataCreate()->createPVStructure(Structure);
+  ValueOffset = Prototype->getSubField("value")->getFieldOffset();
+  SecondsOffset =
+      Prototype->getSubField("timeStamp.secondsPastEpoch")->getFieldOffset();
+  NanosecondsOffset =
+      Prototype->getSubField("timeStamp.nanoseconds")->getFieldOffset();
+  PoissonDistribution = std::poisson_distribution<size_t>(
+      std::max(Settings.UpdatesPerPeriod, 1e-9));
+  auto BurstSize = std::max<size_t>(Settings.BurstSize, 1);
+  BurstDistribution = std::bernoulli_distribution(
+      std::min(1.0, Settings.UpdatesPerPeriod / BurstSize));
+}
+
 int EpicsClientRandom::emit(std::shared_ptr<FlatBufs::EpicsPVUpdate> up) {
   EmitQueue->enqueue(up);
   return 1;
@@ -13,27 +66,64 @@ int EpicsClientRandom::emit(std::shared_ptr<FlatBufs::EpicsPVUpdate> up) {
 
 void EpicsClientRandom::generateFakePVUpdate() {
   auto FakePVUpdate = make_unique<FlatBufs::EpicsPVUpdate>();
+  auto Timestamp = getCurrentTimestamp();
   FakePVUpdate->epics_pvstr = epics::pvData::PVStructure::shared_pointer(
-      createFakePVStructure(UniformDistribution(RandomEngine)));
+      createFakePVStructure(UniformDistribution(RandomEngine), Timestamp));
   FakePVUpdate->channel = ChannelInformation.channel_name;
-  FakePVUpdate->ts_epics_monitor = getCurrentTimestamp();
+  FakePVUpdate->ts_epics_monitor = Timestamp;
   FakePVUpdate->seq_data = 0;
-  FakePVUpdate->seq_fwd = 0;
+  FakePVUpdate->seq_fwd = Sequence++;
 
   emit(std::move(FakePVUpdate));
 }
 
+size_t EpicsClientRandom::generateFakePVUpdates() {
+  size_t Count = 0;
+  switch (Settings.Arrival) {
+  case FakePVArrival::Periodic:
+    Count = static_cast<size_t>(Settings.UpdatesPerPeriod + 0.5);
+    break;
+  case FakePVArrival::Poisson:
+    Count = PoissonDistribution(RandomEngine);
+    break;
+  case FakePVArrival::Bursty:
+    Count = BurstDistribution(RandomEngine) ? Settings.BurstSize : 0;
+    break;
+  }
+  for (size_t i = 0; i < Count; ++i) {
+    generateFakePVUpdate();
+  }
+  return Count;
+}
+
+/// Arrays are a ramp which starts at the random value.
 epics::pvData::PVStructurePtr
-EpicsClientRandom::createFakePVStructure(double Value) const {
-  auto FieldCreator = epics::pvData::getFieldCreate();
-  auto PVDataCreator = epics::pvData::getPVDataCreate();
-  auto PVFieldBuilder = FieldCreator->createFieldBuilder();
-  auto Structure =
-      PVFieldBuilder->add("value", epics::pvData::pvDouble)->createStructure();
-  auto FakePVStructure = PVDataCreator->createPVStructure(Structure);
-  epics::pvData::PVDoublePtr FakePVDouble =
-      FakePVStructure->getSubField<epics::pvData::PVDouble>("value");
-  FakePVDouble->put(Value);
+EpicsClientRandom::createFakePVStructure(double Value, uint64_t Timestamp) {
+  auto FakePVStructure = pvd::getPVDataCreate()->createPVStructure(Structure);
+  if (Settings.ArraySize == 0) {
+    FakePVStructure->getSubField<pvd::PVScalar>(ValueOffset)
+        ->putFrom<double>(Value);
+  } else {
+    pvd::shared_vector<double> Ramp(Settings.ArraySize);
+    for (size_t i = 0; i < Ramp.size(); ++i) {
+      Ramp[i] = Value + i;
+    }
+    pvd::shared_vector<void const> Values;
+    if (Type == pvd::pvDouble) {
+      Values = pvd::static_shared_vector_cast<void const>(pvd::freeze(Ramp));
+    } else {
+      auto Converted = pvd::ScalarTypeFunc::allocArray(Type, Ramp.size());
+      pvd::castUnsafeV(Ramp.size(), Type, Converted.data(), pvd::pvDouble,
+                       Ramp.data());
+      Values = pvd::freeze(Converted);
+    }
+    FakePVStructure->getSubField<pvd::PVScalarArray>(ValueOffset)
+        ->putFrom(Values);
+  }
+  FakePVStructure->getSubField<pvd::PVLong>(SecondsOffset)
+      ->put(static_cast<int64_t>(Timestamp / 1000000000));
+  FakePVStructure->getSubField<pvd::PVInt>(NanosecondsOffset)
+      ->put(static_cast<int32_t>(Timestamp % 1000000000));
   return FakePVStructure;
 }
 
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "EpicsClientInterface.h"
+#include "FakePVSettings.h"
 #include <Stream.h>
 #include <concurrentqueue/concurrentqueue.h>
+#include <pv/pvData.h>
 #include <random>
 
 namespace FlatBufs {
@@ -14,29 +16,43 @@ namespace EpicsClient {
 
 /// A fake EpicsClient implementation which generates PVUpdates containing
 /// random numbers, for testing purposes
+///
+/// The updates have alarm and timeStamp like those of an IOC. The structure
+/// is created once, so that the generator can sustain the update rates
+/// needed for load tests.
 class EpicsClientRandom : public EpicsClientInterface {
 public:
   explicit EpicsClientRandom(
       ChannelInfo &channelInfo,
       std::shared_ptr<
           moodycamel::ConcurrentQueue<std::shared_ptr<FlatBufs::EpicsPVUpdate>>>
-          RingBuffer)
-      : ChannelInformation(channelInfo), EmitQueue(RingBuffer),
-        UniformDistribution(0, 100){};
+          RingBuffer);
   ~EpicsClientRandom() override = default;
   int emit(std::shared_ptr<FlatBufs::EpicsPVUpdate> up) override;
   int stop() override { return 0; };
   void errorInEpics() override { status_ = -1; };
   int status() override { return status_; };
 
+  /// Changes type, array size and arrival pattern of the generated updates.
+  ///
+  /// \throws std::invalid_argument if the type name is unknown.
+  void setSettings(FakePVSettings const &NewSettings);
+
   /// Generate a fake EpicsPVUpdate and emit it
   void generateFakePVUpdate();
 
+  /// Generate and emit the updates of one period according to the arrival
+  /// pattern.
+  ///
+  /// \return The number of generated updates.
+  size_t generateFakePVUpdates();
+
 private:
   /// Get current time since unix epoch in nanoseconds
   uint64_t getCurrentTimestamp() const;
   /// Create a PVStructure with the specified value
-  epics::pvData::PVStructurePtr createFakePVStructure(double Value) const;
+  epics::pvData::PVStructurePtr createFakePVStructure(double Value,
+                                                      uint64_t Timestamp);
 
   ChannelInfo ChannelInformation;
   /// Buffer of (fake) PVUpdates
@@ -45,9 +61,22 @@ private:
       EmitQueue;
   /// Status is set to 1 if something fails
   int status_{0};
+  /// Forwarding sequence number of the next fake update
+  uint64_t Sequence = 0;
+  FakePVSettings Settings;
+  /// Settings.Type as pvData type.
+  epics::pvData::ScalarType Type = epics::pvData::pvDouble;
+  /// Introspection of the updates, created once per settings.
+  epics::pvData::StructureConstPtr Structure;
+  /// Offsets of the fields which are set in every update.
+  size_t ValueOffset = 0;
+  size_t SecondsOffset = 0;
+  size_t NanosecondsOffset = 0;
   /// Tools for generating random doubles
   std::uniform_real_distribution<double> UniformDistribution;
   std::default_random_engine RandomEngine;
+  std::poisson_distribution<size_t> PoissonDistribution;
+  std::bernoulli_distribution BurstDistribution;
 };
 }
 }
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace Forwarder {
+namespace EpicsClient {
+
+/// How many updates a fake PV generates per period of the timer.
+enum class FakePVArrival {
+  /// Always UpdatesPerPeriod updates.
+  Periodic,
+  /// Poisson distributed with mean UpdatesPerPeriod.
+  Poisson,
+  /// BurstSize updates at once, often enough for UpdatesPerPeriod on average.
+  /// At most one burst is sent per period, so the rate is capped at
+  /// BurstSize updates per period.
+  Bursty,
+};
+
+/// \throws std::runtime_error if the name is not periodic, poisson or bursty.
+FakePVArrival parseFakePVArrival(std::string const &Name);
+
+/// Settings of EpicsClientRandom. Kept free of pvData, so that the command
+/// line options can hold them.
+struct FakePVSettings {
+  /// pvData scalar type name of the value.
+  std::string Type = "double";
+  /// Number of elements of the value, a scalar if zero.
+  size_t ArraySize = 0;
+  FakePVArrival Arrival = FakePVArrival::Periodic;
+  double UpdatesPerPeriod = 1;
+  size_t BurstSize = 100;
+};
+}
+}
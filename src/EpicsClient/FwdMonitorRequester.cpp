@@ -74,6 +74,14 @@ void FwdMonitorRequester::monitorEvent(
     // Structure.
     // Does that mean that we never get a scalar here directly??
 
+    // An overrun means that the monitor queue dropped updates of this PV.
+    // The number is not known, skip one sequence number so that the gap is
+    // visible downstream.
+    if (ele->overrunBitSet && ele->overrunBitSet->nextSetBit(0) >= 0) {
+      CLOG(6, 6, "monitor overrun on {}", channel_name);
+      seq += 1;
+    }
+
     auto Update = std::make_shared<FlatBufs::EpicsPVUpdate>();
     Update->channel = channel_name;
     Update->epics_pvstr = epics::pvData::PVStructure::shared_pointer(
@@ -81,8 +89,11 @@ void FwdMonitorRequester::monitorEvent(
     Update->epics_pvstr->copyUnchecked(*ele->pvStructurePtr);
     Monitor->release(ele);
     Update->seq_fwd = seq;
+    seq_data_received.insert(seq);
     Update->seq_data = seq_data;
     Update->ts_epics_monitor = ts;
+    Update->SequenceStart = First;
+    First = false;
     Updates.push_back(Update);
     seq += 1;
   }
@@ -90,7 +101,7 @@ void FwdMonitorRequester::monitorEvent(
     auto seq_data = up->seq_data;
     auto x = epics_client->emit(up);
     if (x != 0) {
-      LOG(5, "error can not push update {}", seq_data);
+      LOG_LIMITED(5, "error can not push update {}", seq_data);
     }
   }
 }
@@ -54,6 +54,8 @@ private:
   std::string name;
   std::string channel_name;
   uint64_t seq = 0;
+  /// True until the first update of this monitor was created.
+  bool First = true;
   EpicsClientInterface *epics_client = nullptr;
   RangeSet<uint64_t> seq_data_received;
 };
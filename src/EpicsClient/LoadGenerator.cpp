@@ -0,0 +1,235 @@
+#include "LoadGenerator.h"
+#include "logger.h"
+#include <algorithm>
+#include <pv/pvIntrospect.h>
+#include <sstream>
+#include <stdexcept>
+#if HAVE_PVDATABASE
+#include <pv/channelProviderLocal.h>
+#include <pv/pvDatabase.h>
+#include <pv/pvTimeStamp.h>
+#include <pv/serverContext.h>
+#include <pv/standardPVField.h>
+#include <pv/typeCast.h>
+#endif
+
+namespace Forwarder {
+namespace EpicsClient {
+
+LoadGeneratorGroup parseLoadGeneratorGroup(std::string const &Description) {
+  std::vector<std::string> Parts;
+  std::istringstream Stream(Description);
+  std::string Part;
+  while (std::getline(Stream, Part, ',')) {
+    Parts.push_back(Part);
+  }
+  if (Parts.size() != 4) {
+    throw std::runtime_error(fmt::format(
+        "Expected <type>,<count>,<array size>,<period ms> instead of {}",
+        Description));
+  }
+  LoadGeneratorGroup Group;
+  try {
+    // Only checks that the type exists.
+    epics::pvData::ScalarTypeFunc::getScalarType(Parts[0]);
+    Group.Type = Parts[0];
+    Group.Count = std::stoull(Parts[1]);
+    Group.ArraySize = std::stoull(Parts[2]);
+    Group.Period = std::chrono::milliseconds(std::stoull(Parts[3]));
+  } catch (std::exception const &) {
+    throw std::runtime_error(
+        fmt::format("Invalid load generator group: {}", Description));
+  }
+  if (Group.Count == 0 || Group.Period.count() == 0) {
+    throw std::runtime_error(fmt::format(
+        "Load generator group needs PVs and a period: {}", Description));
+  }
+  return Group;
+}
+
+LoadGenerator::LoadGenerator(std::string Prefix,
+                             std::vector<LoadGeneratorGroup> Groups)
+    : Prefix(std::move(Prefix)), Groups(std::move(Groups)) {}
+
+LoadGenerator::~LoadGenerator() { stop(); }
+
+std::string LoadGenerator::channelName(size_t Group, size_t Index) const {
+  return fmt::format("{}{}:{}", Prefix, Group, Index);
+}
+
+#if HAVE_PVDATABASE
+bool const LoadGenerator::HavePVDatabase = true;
+
+namespace pvd = epics::pvData;
+
+namespace {
+struct ServedRecord {
+  epics::pvDatabase::PVRecordPtr PVRecord;
+  pvd::PVScalarPtr Scalar;
+  pvd::PVScalarArrayPtr Array;
+  pvd::PVTimeStamp TimeStamp;
+};
+
+struct ServedGroup {
+  pvd::ScalarType Type;
+  std::vector<ServedRecord> Records;
+  std::chrono::steady_clock::time_point Due;
+  uint64_t Tick = 0;
+};
+}
+
+struct LoadGenerator::Records {
+  std::vector<ServedGroup> Groups;
+  epics::pvAccess::ServerContext::shared_pointer Server;
+  void removeAll() {
+    auto Database = epics::pvDatabase::PVDatabase::getMaster();
+    for (auto &Group : Groups) {
+      for (auto &Record : Group.Records) {
+        Database->removeRecord(Record.PVRecord);
+      }
+    }
+    Groups.clear();
+  }
+};
+
+int LoadGenerator::start() {
+  std::unique_lock<std::mutex> lock(Mutex);
+  if (Running) {
+    return 0;
+  }
+  auto Database = epics::pvDatabase::PVDatabase::getMaster();
+  // Registers the "local" provider which serves the records.
+  epics::pvDatabase::getChannelProviderLocal();
+  auto StandardPVField = pvd::getStandardPVField();
+  std::unique_ptr<Records> NewRecords(new Records);
+  for (size_t i = 0; i < Groups.size(); ++i) {
+    auto const &Settings = Groups[i];
+    NewRecords->Groups.emplace_back();
+    auto &Group = NewRecords->Groups.back();
+    Group.Type = pvd::ScalarTypeFunc::getScalarType(Settings.Type);
+    for (size_t j = 0; j < Settings.Count; ++j) {
+      ServedRecord Record;
+      pvd::PVStructurePtr Structure;
+      if (Settings.ArraySize == 0) {
+        Structure = StandardPVField->scalar(Group.Type, "alarm,timeStamp");
+        Record.Scalar = Structure->getSubField<pvd::PVScalar>("value");
+      } else {
+        Structure = StandardPVField->scalarArray(Group.Type, "alarm,timeStamp");
+        Record.Array = Structure->getSubField<pvd::PVScalarArray>("value");
+      }
+      Record.TimeStamp.attach(Structure->getSubField("timeStamp"));
+      Record.PVRecord =
+          epics::pvDatabase::PVRecord::create(channelName(i, j), Structure);
+      if (!Database->addRecord(Record.PVRecord)) {
+        LOG(3, "Load generator can not add record {}", channelName(i, j));
+        NewRecords->removeAll();
+        return -1;
+      }
+      Group.Records.push_back(Record);
+    }
+    LOG(6, "Load generator serves {} to {} with {} {} elements every {} ms",
+        channelName(i, 0), channelName(i, Settings.Count - 1),
+        Settings.ArraySize, Settings.Type,
+        Settings.Period.count());
+  }
+  NewRecords->Server = epics::pvAccess::startPVAServer("local", 0, true, false);
+  Served = std::move(NewRecords);
+  Running = true;
+  Updater = std::thread([this] { run(); });
+  return 0;
+}
+
+void LoadGenerator::stop() {
+  {
+    std::unique_lock<std::mutex> lock(Mutex);
+    if (!Running) {
+      return;
+    }
+    Running = false;
+  }
+  Stopping.notify_all();
+  Updater.join();
+  Served->Server->destroy();
+  Served->removeAll();
+  Served.reset();
+}
+
+/// Posts the next update of all PVs of the group. The values change on every
+/// update and arrays are converted only once per group.
+static void updateGroup(LoadGeneratorGroup const &Settings,
+                        ServedGroup &Group) {
+  auto &Records = Group.Records;
+  auto Tick = Group.Tick++;
+  pvd::TimeStamp Now;
+  Now.getCurrent();
+  pvd::shared_vector<void const> Values;
+  if (Settings.ArraySize > 0) {
+    pvd::shared_vector<double> Doubles(Settings.ArraySize);
+    for (size_t i = 0; i < Doubles.size(); ++i) {
+      Doubles[i] = static_cast<double>((Tick + i) % 1000);
+    }
+    auto Converted =
+        pvd::ScalarTypeFunc::allocArray(Group.Type, Settings.ArraySize);
+    pvd::castUnsafeV(Settings.ArraySize, Group.Type, Converted.data(),
+                     pvd::pvDouble, Doubles.data());
+    Values = pvd::freeze(Converted);
+  }
+  for (size_t i = 0; i < Records.size(); ++i) {
+    auto &Record = Records[i];
+    Record.PVRecord->lock();
+    Record.PVRecord->beginGroupPut();
+    if (Record.Scalar) {
+      Record.Scalar->putFrom<double>(static_cast<double>((Tick + i) % 1000));
+    } else {
+      Record.Array->putFrom(Values);
+    }
+    Record.TimeStamp.set(Now);
+    Record.PVRecord->endGroupPut();
+    Record.PVRecord->unlock();
+  }
+}
+
+void LoadGenerator::run() {
+  auto Now = std::chrono::steady_clock::now();
+  for (auto &Group : Served->Groups) {
+    Group.Due = Now;
+  }
+  std::unique_lock<std::mutex> lock(Mutex);
+  while (Running) {
+    lock.unlock();
+    Now = std::chrono::steady_clock::now();
+    auto Next = Now + std::chrono::seconds(1);
+    for (size_t i = 0; i < Groups.size(); ++i) {
+      auto &Group = Served->Groups[i];
+      if (Group.Due <= Now) {
+        updateGroup(Groups[i], Group);
+        Updates += Group.Records.size();
+        Group.Due += Groups[i].Period;
+        if (Group.Due <= Now) {
+          // Do not try to catch up, which would only make it worse.
+          ++Late;
+          Group.Due = Now + Groups[i].Period;
+        }
+      }
+      Next = std::min(Next, Group.Due);
+    }
+    lock.lock();
+    Stopping.wait_until(lock, Next, [this] { return !Running; });
+  }
+}
+#else
+bool const LoadGenerator::HavePVDatabase = false;
+
+struct LoadGenerator::Records {};
+
+int LoadGenerator::start() {
+  LOG(3, "The load generator needs pvDatabase, which is not available");
+  return -1;
+}
+
+void LoadGenerator::stop() {}
+
+void LoadGenerator::run() {}
+#endif
+}
+}
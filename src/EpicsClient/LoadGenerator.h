@@ -0,0 +1,56 @@
+#pragma once
+
+#include "LoadGeneratorGroup.h"
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Forwarder {
+namespace EpicsClient {
+
+/// \brief
+/// In-process pvAccess server which serves PVs with generated values.
+///
+/// The PVs carry alarm and timeStamp like the records of an IOC and are
+/// served by the "local" provider of pvDatabase. The forwarder then receives
+/// them through the full pvAccess client path over the loopback interface,
+/// which makes it possible to stress test and profile the forwarder without
+/// external IOCs. The channels are named <prefix><group>:<index>.
+///
+/// Only available if compiled with pvDatabase support.
+class LoadGenerator {
+public:
+  /// Set to true if we are compiled with pvDatabase support
+  static bool const HavePVDatabase;
+  LoadGenerator(std::string Prefix, std::vector<LoadGeneratorGroup> Groups);
+  ~LoadGenerator();
+  /// Creates the records and starts the server and the update thread.
+  ///
+  /// \return 0 on success.
+  int start();
+  void stop();
+  std::string channelName(size_t Group, size_t Index) const;
+  /// Number of PV updates posted so far.
+  uint64_t updateCount() const { return Updates.load(); }
+  /// Number of times a group could not keep up with its period.
+  uint64_t lateCount() const { return Late.load(); }
+
+private:
+  struct Records;
+  void run();
+  std::string Prefix;
+  std::vector<LoadGeneratorGroup> Groups;
+  std::unique_ptr<Records> Served;
+  std::atomic<uint64_t> Updates{0};
+  std::atomic<uint64_t> Late{0};
+  std::mutex Mutex;
+  std::condition_variable Stopping;
+  bool Running = false;
+  std::thread Updater;
+};
+}
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace Forwarder {
+namespace EpicsClient {
+
+/// PVs of the load generator which share type, array size and update period.
+struct LoadGeneratorGroup {
+  /// pvData scalar type name of the values.
+  std::string Type = "double";
+  /// Number of elements of the value, a scalar if zero.
+  size_t ArraySize = 0;
+  size_t Count = 1;
+  std::chrono::milliseconds Period{1000};
+};
+
+/// Parses a group from "<type>,<count>,<array size>,<period ms>", for
+/// example "double,100,0,10" or "short,4,100000,100". The type is a pvData
+/// scalar type name.
+///
+/// \throws std::runtime_error if the description is invalid.
+LoadGeneratorGroup parseLoadGeneratorGroup(std::string const &Description);
+}
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <pv/pvData.h>
 #include <string>
@@ -11,7 +12,10 @@ class ConversionPath;
 /// Represents and Epics update with the new PV value
 struct EpicsPVUpdate {
   EpicsPVUpdate() = default;
-  EpicsPVUpdate(EpicsPVUpdate const &x) = default;
+  EpicsPVUpdate(EpicsPVUpdate const &x)
+      : epics_pvstr(x.epics_pvstr), channel(x.channel), seq_data(x.seq_data),
+        seq_fwd(x.seq_fwd), ts_epics_monitor(x.ts_epics_monitor),
+        SequenceStart(x.SequenceStart) {}
   EpicsPVUpdate(EpicsPVUpdate &&) = delete;
   ~EpicsPVUpdate() = default;
   ::epics::pvData::PVStructure::shared_pointer epics_pvstr;
@@ -21,5 +25,11 @@ struct EpicsPVUpdate {
   uint64_t seq_fwd = 0;
   /// Timestamp when monitorEvent() was called
   uint64_t ts_epics_monitor = 0;
+  /// Set on the first update of a monitor, seq_fwd starts a new sequence.
+  bool SequenceStart = false;
+  /// Set when the same update is emitted again as the cached value. It is
+  /// never reset, so converters may keep the serialized result of such an
+  /// update around and produce it again without converting.
+  std::atomic<bool> Repeated{false};
 };
 }
@@ -17,6 +17,17 @@ FlatbufferMessage::FlatbufferMessage()
 FlatbufferMessage::FlatbufferMessage(uint32_t initial_size)
     : builder(new flatbuffers::FlatBufferBuilder(initial_size)) {}
 
+FlatbufferMessage::FlatbufferMessage(
+    std::shared_ptr<std::vector<uint8_t> const> Serialized)
+    : Serialized(std::move(Serialized)) {}
+
+FlatbufferMessage::uptr FlatbufferMessage::create(uint32_t InitialSize) {
+  if (InitialSize == 0) {
+    return uptr(new FlatbufferMessage());
+  }
+  return uptr(new FlatbufferMessage(InitialSize));
+}
+
 /// \brief Your chance to implement your own memory recycling.
 
 FlatbufferMessage::~FlatbufferMessage() {}
@@ -25,6 +36,10 @@ FlatbufferMessage::~FlatbufferMessage() {}
 /// Called when actually writing to Kafka.
 
 FlatbufferMessageSlice FlatbufferMessage::message() {
+  if (!builder && Serialized) {
+    // The payload is only read when producing.
+    return {const_cast<uint8_t *>(Serialized->data()), Serialized->size()};
+  }
   if (!builder) {
     CLOG(8, 1, "builder no longer available");
     return {nullptr, 0};
@@ -34,5 +49,17 @@ FlatbufferMessageSlice FlatbufferMessage::message() {
   return ret;
 }
 
+void FlatbufferMessage::deliveryOk() {
+  if (Observer) {
+    Observer->deliveryOk();
+  }
+}
+
+void FlatbufferMessage::deliveryError() {
+  if (Observer) {
+    Observer->deliveryFailed();
+  }
+}
+
 void inspect(FlatbufferMessage const &fb) {}
 }
@@ -5,6 +5,7 @@
 #include <flatbuffers/flatbuffers.h>
 #include <memory>
 #include <utility>
+#include <vector>
 
 namespace FlatBufs {
 
@@ -15,6 +16,14 @@ class Converter;
 class ConverterTestNamed;
 }
 
+/// Gets notified about the outcome of the asynchronous delivery to Kafka.
+class DeliveryObserver {
+public:
+  virtual ~DeliveryObserver() = default;
+  virtual void deliveryOk() = 0;
+  virtual void deliveryFailed() = 0;
+};
+
 /// \brief
 /// Holds the flatbuffer until it has been sent.
 ///
@@ -26,14 +35,26 @@ class ConverterTestNamed;
 class FlatbufferMessage : public KafkaW::Producer::Msg {
 public:
   using uptr = std::unique_ptr<FlatbufferMessage>;
+  /// Message with a builder of the given initial size, or of the default size
+  /// if the size is zero.
+  static uptr create(uint32_t InitialSize);
   FlatbufferMessage();
   FlatbufferMessage(uint32_t initial_size);
+  /// Message without a builder which produces an already serialized
+  /// flatbuffer. The buffer may be shared by any number of messages.
+  explicit FlatbufferMessage(
+      std::shared_ptr<std::vector<uint8_t> const> Serialized);
   ~FlatbufferMessage() override;
   FlatbufferMessageSlice message();
+  void deliveryOk() override;
+  void deliveryError() override;
   std::unique_ptr<flatbuffers::FlatBufferBuilder> builder;
+  /// Optional, notified when the delivery callback for this message runs.
+  std::shared_ptr<DeliveryObserver> Observer;
 
 private:
   FlatbufferMessage(FlatbufferMessage const &) = delete;
+  std::shared_ptr<std::vector<uint8_t> const> Serialized;
   // Used for performance tests, please do not touch.
   uint64_t seq = 0;
   uint32_t fwdix = 0;
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <flatbuffers/flatbuffers.h>
+
+namespace FlatBufs {
+
+using StringVectorOffset = flatbuffers::Offset<
+    flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>>>;
+
+/// The size of the builder after a string of the given length was created
+/// in a builder of the given size: padding, terminating zero, the string
+/// data and its length field.
+inline flatbuffers::uoffset_t stringEnd(flatbuffers::uoffset_t Size,
+                                        size_t Length) {
+  size_t End = Size + Length + 1;
+  End += flatbuffers::PaddingBytes(End, sizeof(flatbuffers::uoffset_t));
+  return static_cast<flatbuffers::uoffset_t>(End +
+                                             sizeof(flatbuffers::uoffset_t));
+}
+
+/// \brief
+/// Creates a vector of strings from a container of std::string.
+///
+/// The strings are created back to front and directly followed by the
+/// vector. The offset of a created string is the size of the builder right
+/// after it, so the offsets are computed again from the string lengths while
+/// the vector is written instead of collecting them in a temporary vector.
+template <typename Strings>
+StringVectorOffset createStringVector(flatbuffers::FlatBufferBuilder &Builder,
+                                      Strings const &View) {
+  size_t Count = View.size();
+  auto Size = Builder.GetSize();
+  for (size_t i = Count; i > 0; --i) {
+    auto const &String = View[i - 1];
+    Builder.CreateString(String.data(), String.size());
+  }
+  Builder.StartVector(Count, sizeof(flatbuffers::uoffset_t));
+  for (size_t i = Count; i > 0; --i) {
+    Size = stringEnd(Size, View[i - 1].size());
+    Builder.PushElement(flatbuffers::Offset<flatbuffers::String>(Size));
+  }
+  return StringVectorOffset(Builder.EndVector(Count));
+}
+}
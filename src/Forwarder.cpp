@@ -1,14 +1,22 @@
 #include "Forwarder.h"
 #include "CommandHandler.h"
 #include "Converter.h"
+#include "KafkaW/MockProducer.h"
 #include "Stream.h"
 #include "Timer.h"
 #include "helper.h"
 #include "logger.h"
+#include <EpicsClient/EpicsClientCA.h>
 #include <EpicsClient/EpicsClientInterface.h>
 #include <EpicsClient/EpicsClientMonitor.h>
 #include <EpicsClient/EpicsClientRandom.h>
+#include <EpicsClient/LoadGenerator.h>
+#include <functional>
+#include <fstream>
 #include <nlohmann/json.hpp>
+#include <set>
+#include <sstream>
+#include <sys/stat.h>
 #include <sys/types.h>
 #ifdef _MSC_VER
 #include "process.h"
@@ -17,6 +25,7 @@
 #include <unistd.h>
 #endif
 #include "CURLReporter.h"
+#include "MetricsServer.h"
 
 namespace Forwarder {
 
@@ -34,11 +43,64 @@ static KafkaW::BrokerSettings make_broker_opt(MainOpt const &opt) {
 
 using ulock = std::unique_lock<std::mutex>;
 
+std::chrono::milliseconds const Forwarder::PeriodicUpdateResolution{50};
+
+size_t const Forwarder::PeriodicUpdateSlots = 1024;
+
+static FileVersion fileVersion(std::string const &Path) {
+  FileVersion Version;
+  struct stat Status;
+  if (stat(Path.c_str(), &Status) != 0) {
+    return Version;
+  }
+  Version.Seconds = static_cast<int64_t>(Status.st_mtime);
+#if defined(__APPLE__)
+  Version.Nanoseconds = static_cast<int64_t>(Status.st_mtimespec.tv_nsec);
+#elif !defined(_WIN32)
+  Version.Nanoseconds = static_cast<int64_t>(Status.st_mtim.tv_nsec);
+#endif
+  Version.Size = static_cast<int64_t>(Status.st_size);
+  return Version;
+}
+
+/// Whether changing from monitor settings A to B requires a new monitor.
+static bool sameMonitor(MonitorSettings const &A, MonitorSettings const &B) {
+  return A.QueueSize == B.QueueSize && A.Pipeline == B.Pipeline &&
+         A.Fields == B.Fields;
+}
+
+/// Whether two converter lists produce the same output. The converter names
+/// are generated from the position in the configuration when they are not
+/// given, so they are not compared.
+static bool sameConverters(std::vector<ConverterSettings> const &A,
+                           std::vector<ConverterSettings> const &B) {
+  return A.size() == B.size() &&
+         std::equal(A.begin(), A.end(), B.begin(),
+                    [](ConverterSettings const &X, ConverterSettings const &Y) {
+                      return X.Schema == Y.Schema && X.Topic == Y.Topic;
+                    });
+}
+
+/// Producer for --mock-kafka. The messages are not recorded because the
+/// forwarder may run for a long time.
+static std::shared_ptr<KafkaW::Producer>
+createMockProducer(KafkaW::BrokerSettings BrokerSettings) {
+  auto Producer = std::make_shared<KafkaW::MockProducer>(BrokerSettings);
+  Producer->RecordMessages = false;
+  return Producer;
+}
+
 /// \class Main
 /// \brief Main program entry class.
 Forwarder::Forwarder(MainOpt &opt)
     : main_opt(opt), kafka_instance_set(InstanceSet::Set(make_broker_opt(opt))),
+      PeriodicUpdates(PeriodicUpdateResolution, PeriodicUpdateSlots),
       conversion_scheduler(this) {
+  // The instance set creates its producers only when they are first needed.
+  if (main_opt.MockKafka) {
+    LOG(4, "Producing to mock Kafka producers, nothing is sent to brokers");
+    InstanceSet::setProducerFactory(createMockProducer);
+  }
 
   for (size_t i = 0; i < opt.MainSettings.ConversionThreads; ++i) {
     conversion_workers.emplace_back(make_unique<ConversionWorker>(
@@ -62,22 +124,40 @@ Forwarder::Forwarder(MainOpt &opt)
     config_listener.reset(
         new Config::Listener{bopt, main_opt.MainSettings.BrokerConfig});
   }
-  createPVUpdateTimerIfRequired();
   createFakePVUpdateTimerIfRequired();
-
-  for (auto &Stream : main_opt.MainSettings.StreamsInfo) {
-    try {
-      addMapping(Stream);
-    } catch (std::exception &e) {
-      LOG(4, "Could not add mapping: {}  {}", Stream.Name, e.what());
+  if (!main_opt.LoadGeneratorGroups.empty()) {
+    LoadGenerator = ::make_unique<EpicsClient::LoadGenerator>(
+        main_opt.LoadGeneratorPrefix, main_opt.LoadGeneratorGroups);
+    if (LoadGenerator->start() != 0) {
+      LoadGenerator.reset();
     }
   }
+  EpicsClient::EpicsClientFactoryInit::setContextCount(
+      main_opt.MainSettings.EpicsClientContexts);
 
-  curl = ::make_unique<CURLReporter>();
+  addMappings(main_opt.MainSettings.StreamsInfo);
+  if (main_opt.WatchConfigFile && !main_opt.ConfigurationFile.empty()) {
+    ConfigFileApplied = fileVersion(main_opt.ConfigurationFile);
+  }
+
+  if (CURLReporter::HaveCURL && !main_opt.InfluxURI.empty()) {
+    curl = ::make_unique<CURLReporter>();
+  }
+  if (main_opt.MetricsPort > 0) {
+    metrics_server = ::make_unique<MetricsServer>(main_opt.MetricsPort);
+    if (metrics_server->start() != 0) {
+      metrics_server.reset();
+    }
+  }
   if (!main_opt.MainSettings.StatusReportURI.host.empty()) {
     KafkaW::BrokerSettings BrokerSettings;
     BrokerSettings.Address = main_opt.MainSettings.StatusReportURI.host_port;
-    status_producer = std::make_shared<KafkaW::Producer>(BrokerSettings);
+    BrokerSettings.PollTimeoutMS = 0;
+    if (main_opt.MockKafka) {
+      status_producer = createMockProducer(BrokerSettings);
+    } else {
+      status_producer = std::make_shared<KafkaW::Producer>(BrokerSettings);
+    }
     status_producer_topic = ::make_unique<KafkaW::ProducerTopic>(
         status_producer, main_opt.MainSettings.StatusReportURI.topic);
   }
@@ -87,16 +167,13 @@ Forwarder::~Forwarder() {
   LOG(7, "~Main");
   streams.streams_clear();
   conversion_workers_clear();
+  streams.drain_retired(std::chrono::milliseconds(5000));
   converters_clear();
   InstanceSet::clear();
-}
-
-void Forwarder::createPVUpdateTimerIfRequired() {
-  if (main_opt.PeriodMS > 0) {
-    auto Interval = std::chrono::milliseconds(main_opt.PeriodMS);
-    std::shared_ptr<Sleeper> IntervalSleeper = std::make_shared<RealSleeper>();
-    PVUpdateTimer = ::make_unique<Timer>(Interval, IntervalSleeper);
+  if (main_opt.MockKafka) {
+    InstanceSet::setProducerFactory(nullptr);
   }
+  LoadGenerator.reset();
 }
 
 void Forwarder::createFakePVUpdateTimerIfRequired() {
@@ -128,10 +205,6 @@ int Forwarder::converters_clear() {
   return 0;
 }
 
-std::unique_lock<std::mutex> Forwarder::get_lock_streams() {
-  return std::unique_lock<std::mutex>(streams_mutex);
-}
-
 std::unique_lock<std::mutex> Forwarder::get_lock_converters() {
   return std::unique_lock<std::mutex>(converters_mutex);
 }
@@ -154,9 +227,6 @@ void Forwarder::forward_epics_to_kafka() {
     }
   }
 
-  if (PVUpdateTimer != nullptr)
-    PVUpdateTimer->start();
-
   if (GenerateFakePVUpdateTimer != nullptr)
     GenerateFakePVUpdateTimer->start();
 
@@ -168,17 +238,19 @@ void Forwarder::forward_epics_to_kafka() {
         config_listener->poll(config_cb);
       }
       streams.check_stream_status();
+      reloadConfigFileIfChanged();
+      reportConnectionProgress();
       t_lf_last = t1;
       do_stats = true;
     }
     kafka_instance_set->poll();
+    streams.reclaim(t1);
 
     auto t2 = CLK::now();
     auto dt = std::chrono::duration_cast<MS>(t2 - t1);
     if (t2 - t_status_last > MS(3000)) {
-      if (status_producer_topic) {
-        report_status();
-      }
+      streams.update_rates(t2);
+      report_status();
       t_status_last = t2;
     }
     if (do_stats) {
@@ -197,11 +269,7 @@ void Forwarder::forward_epics_to_kafka() {
   LOG(6, "Main::forward_epics_to_kafka shutting down");
   conversion_workers_clear();
   streams.streams_clear();
-
-  if (PVUpdateTimer != nullptr) {
-    PVUpdateTimer->triggerStop();
-    PVUpdateTimer->waitForStop();
-  }
+  streams.drain_retired(std::chrono::milliseconds(5000));
 
   if (GenerateFakePVUpdateTimer != nullptr) {
     GenerateFakePVUpdateTimer->triggerStop();
@@ -212,14 +280,39 @@ void Forwarder::forward_epics_to_kafka() {
   forwarding_status.store(ForwardingStatus::STOPPED);
 }
 
+/// Number of streams listed in the periodic report of the hottest PVs.
+static size_t const HottestStreamsReportSize = 10;
+
+/// Log the PVs with the highest byte rate and, if a status topic is
+/// configured, produce the status of all streams.
 void Forwarder::report_status() {
   using nlohmann::json;
+  auto Hottest = json::array();
+  fmt::MemoryWriter HottestLog;
+  for (auto const &Stream : streams.hottest(HottestStreamsReportSize)) {
+    auto const &Statistics = Stream->statistics();
+    auto const &ChannelName = Stream->channel_info().channel_name;
+    auto BytesPerSecond = Statistics.BytesPerSecond.load();
+    auto UpdatesPerSecond = Statistics.UpdatesPerSecond.load();
+    Hottest.push_back({{"channel_name", ChannelName},
+                       {"bytes_per_second", BytesPerSecond},
+                       {"updates_per_second", UpdatesPerSecond}});
+    HottestLog.write("\n  {:<40} {:12.1f} B/s {:10.1f} updates/s",
+                     ChannelName, BytesPerSecond, UpdatesPerSecond);
+  }
+  if (!Hottest.empty()) {
+    LOG(6, "hottest streams:{}", HottestLog.c_str());
+  }
+  if (!status_producer_topic) {
+    return;
+  }
   auto Status = json::object();
   auto Streams = json::array();
-  for (auto const &Stream : streams.get_streams()) {
+  for (auto const &Stream : *streams.snapshot()) {
     Streams.push_back(Stream->status_json());
   }
   Status["streams"] = Streams;
+  Status["hottest_streams"] = Hottest;
   auto StatusString = Status.dump();
   auto StatusStringSize = StatusString.size();
   if (StatusStringSize > 1000) {
@@ -232,6 +325,8 @@ void Forwarder::report_status() {
   }
   status_producer_topic->produce((KafkaW::uchar *)StatusString.c_str(),
                                  StatusString.size());
+  // Serves the delivery reports of earlier status messages.
+  status_producer->poll();
 }
 
 void Forwarder::report_stats(int dt) {
@@ -246,7 +341,10 @@ void Forwarder::report_stats(int dt) {
   b2 %= 1024;
   LOG(6, "dt: {:4}  m: {:4}.{:03}  b: {:3}.{:03}.{:03}", dt, m2, m1, b3, b2,
       b1);
-  if (CURLReporter::HaveCURL && !main_opt.InfluxURI.empty()) {
+  if (metrics_server) {
+    metrics_server->setSnapshot(renderMetrics());
+  }
+  if (curl != nullptr) {
     int i1 = 0;
     for (auto &s : kafka_instance_set->stats_all()) {
       auto &m1 = influxbuf;
@@ -287,10 +385,138 @@ void Forwarder::report_stats(int dt) {
         ++i1;
       }
     }
+    influxbuf.write("forward-epics-to-kafka,hostname={}",
+                    main_opt.Hostname.data());
+    influxbuf.write(" influx_dropped={}\n", curl->droppedCount());
     curl->send(influxbuf, main_opt.InfluxURI);
   }
 }
 
+/// Render the producer, converter and stream counters in the Prometheus text
+/// format. Stream counters are summed over all streams, only the hottest
+/// streams are listed individually.
+std::string Forwarder::renderMetrics() {
+  fmt::MemoryWriter Out;
+  auto Metric = [&Out](char const *Name, char const *Type, char const *Help) {
+    Out.write("# HELP forwarder_{} {}\n# TYPE forwarder_{} {}\n", Name, Help,
+              Name, Type);
+  };
+  Metric("messages_produced_total", "counter",
+         "Messages handed to Kafka by all streams.");
+  Out.write("forwarder_messages_produced_total {}\n",
+            g__total_msgs_to_kafka.load());
+  Metric("bytes_produced_total", "counter",
+         "Bytes handed to Kafka by all streams.");
+  Out.write("forwarder_bytes_produced_total {}\n",
+            g__total_bytes_to_kafka.load());
+
+  auto ProducerStats = kafka_instance_set->stats_all();
+  using StatsValue = std::function<uint64_t(KafkaW::ProducerStats const &)>;
+  auto ProducerMetric = [&](char const *Name, char const *Type,
+                            char const *Help, StatsValue Value) {
+    Metric(Name, Type, Help);
+    int Set = 0;
+    for (auto const &s : ProducerStats) {
+      Out.write("forwarder_{}{{set=\"{}\"}} {}\n", Name, Set, Value(s));
+      ++Set;
+    }
+  };
+  ProducerMetric(
+      "producer_produced_total", "counter",
+      "Messages accepted by the Kafka producer.",
+      [](KafkaW::ProducerStats const &s) { return s.produced.load(); });
+  ProducerMetric(
+      "producer_produce_fail_total", "counter",
+      "Messages rejected by the Kafka producer.",
+      [](KafkaW::ProducerStats const &s) { return s.produce_fail.load(); });
+  ProducerMetric(
+      "producer_local_queue_full_total", "counter",
+      "Messages rejected because the local producer queue was full.",
+      [](KafkaW::ProducerStats const &s) { return s.local_queue_full.load(); });
+  ProducerMetric(
+      "producer_delivered_total", "counter", "Messages delivered to Kafka.",
+      [](KafkaW::ProducerStats const &s) { return s.produce_cb.load(); });
+  ProducerMetric(
+      "producer_delivery_failed_total", "counter",
+      "Messages which failed delivery to Kafka.",
+      [](KafkaW::ProducerStats const &s) { return s.produce_cb_fail.load(); });
+  ProducerMetric(
+      "producer_msg_too_large_total", "counter",
+      "Messages rejected for exceeding the maximum message size.",
+      [](KafkaW::ProducerStats const &s) { return s.msg_too_large.load(); });
+  ProducerMetric(
+      "producer_bytes_total", "counter", "Bytes accepted by the producer.",
+      [](KafkaW::ProducerStats const &s) { return s.produced_bytes.load(); });
+  ProducerMetric(
+      "producer_out_queue", "gauge", "Messages waiting in the producer queue.",
+      [](KafkaW::ProducerStats const &s) { return s.out_queue.load(); });
+
+  {
+    auto lock = get_lock_converters();
+    Metric("converter_stat", "gauge", "Converter specific statistics.");
+    for (auto &c : converters) {
+      auto Converter = c.second.lock();
+      if (!Converter) {
+        continue;
+      }
+      auto Name = MetricsServer::escapeLabelValue(c.first);
+      for (auto const &Stat : Converter->stats()) {
+        Out.write("forwarder_converter_stat{{converter=\"{}\",stat=\"{}\"}} "
+                  "{}\n",
+                  Name, MetricsServer::escapeLabelValue(Stat.first),
+                  Stat.second);
+      }
+    }
+  }
+
+  uint64_t Received = 0;
+  uint64_t Converted = 0;
+  uint64_t Produced = 0;
+  uint64_t Dropped = 0;
+  uint64_t Bytes = 0;
+  size_t EmitQueueSize = 0;
+  auto AllStreams = streams.snapshot();
+  for (auto const &Stream : *AllStreams) {
+    auto const &Statistics = Stream->statistics();
+    Received += Statistics.UpdatesReceived.load();
+    Converted += Statistics.UpdatesConverted.load();
+    Produced += Statistics.UpdatesProduced.load();
+    Dropped += Statistics.UpdatesDropped.load();
+    Bytes += Statistics.BytesProduced.load();
+    EmitQueueSize += Stream->emit_queue_size();
+  }
+  Metric("streams", "gauge", "Number of forwarded streams.");
+  Out.write("forwarder_streams {}\n", AllStreams->size());
+  Metric("stream_updates_received_total", "counter",
+         "PV updates taken from the stream queues.");
+  Out.write("forwarder_stream_updates_received_total {}\n", Received);
+  Metric("stream_updates_converted_total", "counter",
+         "PV updates converted to flatbuffers.");
+  Out.write("forwarder_stream_updates_converted_total {}\n", Converted);
+  Metric("stream_updates_produced_total", "counter",
+         "Converted PV updates handed to Kafka.");
+  Out.write("forwarder_stream_updates_produced_total {}\n", Produced);
+  Metric("stream_updates_dropped_total", "counter",
+         "PV updates dropped before reaching Kafka.");
+  Out.write("forwarder_stream_updates_dropped_total {}\n", Dropped);
+  Metric("stream_bytes_produced_total", "counter",
+         "Bytes handed to Kafka by all streams.");
+  Out.write("forwarder_stream_bytes_produced_total {}\n", Bytes);
+  Metric("stream_emit_queue_size", "gauge",
+         "PV updates waiting for conversion.");
+  Out.write("forwarder_stream_emit_queue_size {}\n", EmitQueueSize);
+
+  Metric("hot_stream_bytes_per_second", "gauge",
+         "Byte rate of the streams with the highest byte rate.");
+  for (auto const &Stream : streams.hottest(HottestStreamsReportSize)) {
+    Out.write("forwarder_hot_stream_bytes_per_second{{channel=\"{}\"}} {}\n",
+              MetricsServer::escapeLabelValue(
+                  Stream->channel_info().channel_name),
+              Stream->statistics().BytesPerSecond.load());
+  }
+  return Out.str();
+}
+
 void Forwarder::pushConverterToStream(ConverterSettings const &ConverterInfo,
                                       std::shared_ptr<Stream> &Stream) {
 
@@ -344,46 +570,241 @@ void Forwarder::pushConverterToStream(ConverterSettings const &ConverterInfo,
   Stream->converter_add(*kafka_instance_set, ConverterShared, TopicURI);
 }
 
-void Forwarder::addMapping(StreamSettings const &StreamInfo) {
-  std::unique_lock<std::mutex> lock(streams_mutex);
+/// Creates a stream with its EPICS client and converters. The stream is not
+/// yet known to the conversion workers.
+std::shared_ptr<Stream>
+Forwarder::createStream(StreamSettings const &StreamInfo) {
+  std::shared_ptr<Stream> NewStream;
   try {
-    ChannelInfo ChannelInfo{StreamInfo.EpicsProtocol, StreamInfo.Name};
+    ChannelInfo ChannelInfo{StreamInfo.EpicsProtocol, StreamInfo.Name,
+                            StreamInfo.Monitor};
     std::shared_ptr<EpicsClient::EpicsClientInterface> Client;
     if (GenerateFakePVUpdateTimer != nullptr) {
-      Client = addStream<EpicsClient::EpicsClientRandom>(ChannelInfo);
+      Client = createClient<EpicsClient::EpicsClientRandom>(ChannelInfo,
+                                                            NewStream);
       auto RandomClient =
           std::static_pointer_cast<EpicsClient::EpicsClientRandom>(Client);
+      RandomClient->setSettings(main_opt.FakePV);
       GenerateFakePVUpdateTimer->addCallback(
-          [RandomClient]() { RandomClient->generateFakePVUpdate(); });
+          [RandomClient]() { RandomClient->generateFakePVUpdates(); });
+    } else if (main_opt.MainSettings.NativeCA &&
+               ChannelInfo.provider_type == "ca") {
+      if (!sameMonitor(ChannelInfo.Monitor, MonitorSettings())) {
+        LOG(4, "Monitor options of {} are not supported by native-ca",
+            ChannelInfo.channel_name);
+      }
+      Client =
+          createClient<EpicsClient::EpicsClientCA>(ChannelInfo, NewStream);
     } else
-      Client = addStream<EpicsClient::EpicsClientMonitor>(ChannelInfo);
-    if (PVUpdateTimer != nullptr) {
-      auto PeriodicClient =
-          std::static_pointer_cast<EpicsClient::EpicsClientMonitor>(Client);
-      PVUpdateTimer->addCallback(
-          [PeriodicClient]() { PeriodicClient->emitCachedValue(); });
-    }
+      Client = createClient<EpicsClient::EpicsClientMonitor>(ChannelInfo,
+                                                             NewStream);
   } catch (std::runtime_error &e) {
     std::throw_with_nested(MappingAddException("Cannot add stream"));
   }
 
-  auto Stream = streams.back();
-
   for (auto &Converter : StreamInfo.Converters) {
-    pushConverterToStream(Converter, Stream);
+    pushConverterToStream(Converter, NewStream);
+  }
+  NewStream->set_settings(StreamInfo);
+  addPeriodicUpdate(NewStream);
+  return NewStream;
+}
+
+/// Re-emits the last update of the stream periodically if configured, either
+/// per stream or globally via --pv-update-period. The update stops when the
+/// stream is destroyed.
+void Forwarder::addPeriodicUpdate(std::shared_ptr<Stream> const &Stream) {
+  auto PeriodMS = Stream->settings().PVUpdatePeriodMS;
+  if (PeriodMS == 0) {
+    PeriodMS = main_opt.PeriodMS;
+  }
+  if (PeriodMS == 0) {
+    return;
+  }
+  std::weak_ptr<::Forwarder::Stream> WeakStream = Stream;
+  PeriodicUpdates.add(std::chrono::milliseconds(PeriodMS), [WeakStream]() {
+    if (auto Stream = WeakStream.lock()) {
+      Stream->emit_cached_value();
+      return true;
+    }
+    return false;
+  });
+}
+
+/// Creates a stream which takes over the EPICS channel of Previous but uses
+/// the converters of StreamInfo. The new stream shares the EPICS client of
+/// Previous, so it has to release the client when it is not installed.
+std::shared_ptr<Stream>
+Forwarder::retargetStream(Stream &Previous, StreamSettings const &StreamInfo) {
+  auto NewStream = std::make_shared<Stream>(Previous);
+  try {
+    for (auto &Converter : StreamInfo.Converters) {
+      pushConverterToStream(Converter, NewStream);
+    }
+  } catch (...) {
+    NewStream->release_client();
+    throw;
+  }
+  NewStream->set_settings(StreamInfo);
+  addPeriodicUpdate(NewStream);
+  return NewStream;
+}
+
+void Forwarder::addMapping(StreamSettings const &StreamInfo) {
+  streams.add(createStream(StreamInfo));
+}
+
+/// Adds many mappings at once. All channels are created before any of the
+/// streams is handed to the conversion workers, so that the EPICS client can
+/// search for all of them in parallel. Mappings which fail are logged and
+/// skipped.
+void Forwarder::addMappings(std::vector<StreamSettings> const &StreamsInfo) {
+  std::vector<std::shared_ptr<Stream>> NewStreams;
+  NewStreams.reserve(StreamsInfo.size());
+  for (auto const &StreamInfo : StreamsInfo) {
+    try {
+      NewStreams.push_back(createStream(StreamInfo));
+      if (NewStreams.size() % 1000 == 0) {
+        LOG(6, "Created {} of {} streams", NewStreams.size(),
+            StreamsInfo.size());
+      }
+    } catch (std::exception &e) {
+      LOG(4, "Could not add mapping: {}  {}", StreamInfo.Name, e.what());
+    }
+  }
+  streams.add(NewStreams);
+  if (!NewStreams.empty()) {
+    LOG(6, "Added {} streams", NewStreams.size());
+  }
+}
+
+/// Changes the streams to match the given configuration. Streams which are
+/// not configured anymore are stopped and new ones are added. Streams whose
+/// converters changed take over their EPICS channel, so only the streams
+/// which changed the provider type or monitor options are reconnected.
+/// Unchanged streams are not touched.
+void Forwarder::setMappings(std::vector<StreamSettings> const &StreamsInfo) {
+  std::map<std::string, StreamSettings const *> Desired;
+  for (auto const &StreamInfo : StreamsInfo) {
+    auto &Entry = Desired[StreamInfo.Name];
+    if (Entry != nullptr) {
+      LOG(4, "Channel {} is listed more than once, using the last mapping",
+          StreamInfo.Name);
+    }
+    Entry = &StreamInfo;
+  }
+  std::map<std::string, size_t> Count;
+  auto Current = streams.snapshot();
+  for (auto const &Stream : *Current) {
+    ++Count[Stream->channel_info().channel_name];
+  }
+  size_t Removed = 0;
+  size_t Retargeted = 0;
+  std::set<std::string> Kept;
+  std::set<std::string> Stopped;
+  for (auto const &Stream : *Current) {
+    auto const &Name = Stream->channel_info().channel_name;
+    auto DesiredIt = Desired.find(Name);
+    if (DesiredIt == Desired.end() || Count[Name] > 1 ||
+        DesiredIt->second->EpicsProtocol !=
+            Stream->channel_info().provider_type ||
+        !sameMonitor(DesiredIt->second->Monitor,
+                     Stream->channel_info().Monitor)) {
+      // All streams of the channel are stopped at once.
+      if (Stopped.insert(Name).second) {
+        Removed += streams.channel_stop(Name);
+      }
+      continue;
+    }
+    auto const &StreamInfo = *DesiredIt->second;
+    Kept.insert(Name);
+    // A retargeted stream is also registered for the periodic updates with
+    // its new period.
+    if (sameConverters(Stream->settings().Converters, StreamInfo.Converters) &&
+        Stream->settings().PVUpdatePeriodMS == StreamInfo.PVUpdatePeriodMS) {
+      continue;
+    }
+    try {
+      auto NewStream = retargetStream(*Stream, StreamInfo);
+      if (streams.replace(Stream, NewStream)) {
+        ++Retargeted;
+      } else {
+        NewStream->release_client();
+      }
+    } catch (std::exception &e) {
+      LOG(4, "Could not change mapping: {}  {}", Name, e.what());
+    }
+  }
+  std::vector<StreamSettings> Added;
+  for (auto const &Entry : Desired) {
+    if (Kept.find(Entry.first) == Kept.end()) {
+      Added.push_back(*Entry.second);
+    }
+  }
+  addMappings(Added);
+  LOG(6, "Set mappings: {} added  {} removed  {} retargeted  {} unchanged",
+      Added.size(), Removed, Retargeted, Kept.size() - Retargeted);
+}
+
+/// Applies the streams of the configuration file if the file changed since
+/// it was read last.
+void Forwarder::reloadConfigFileIfChanged() {
+  if (!main_opt.WatchConfigFile || main_opt.ConfigurationFile.empty()) {
+    return;
+  }
+  // Taken before reading, so that a write during the read is noticed on the
+  // next check.
+  auto Version = fileVersion(main_opt.ConfigurationFile);
+  if (Version.Seconds < 0 || Version == ConfigFileApplied ||
+      Version == ConfigFileFailed) {
+    return;
+  }
+  LOG(6, "Configuration file {} changed", main_opt.ConfigurationFile);
+  std::vector<StreamSettings> StreamsInfo;
+  try {
+    std::ifstream File(main_opt.ConfigurationFile);
+    std::stringstream Buffer;
+    Buffer << File.rdbuf();
+    ConfigParser Config;
+    Config.setJsonFromString(Buffer.str());
+    StreamsInfo = Config.extractConfiguration().StreamsInfo;
+  } catch (std::exception &e) {
+    // Possibly a file which is still being written, so the streams are left
+    // as they are until the file changes again.
+    LOG(3, "Can not apply configuration file: {}", e.what());
+    ConfigFileFailed = Version;
+    return;
+  }
+  ConfigFileApplied = Version;
+  try {
+    setMappings(StreamsInfo);
+  } catch (std::exception &e) {
+    LOG(3, "Can not apply configuration file: {}", e.what());
+  }
+}
+
+/// Logs how many of the EPICS channels are connected whenever that number
+/// changes.
+void Forwarder::reportConnectionProgress() {
+  auto Connected = streams.connected_count();
+  if (Connected == LastConnectedCount) {
+    return;
   }
+  LastConnectedCount = Connected;
+  LOG(6, "{} of {} channels connected", Connected, streams.size());
 }
 
 template <typename T>
-std::shared_ptr<T> Forwarder::addStream(ChannelInfo &ChannelInfo) {
+std::shared_ptr<T>
+Forwarder::createClient(ChannelInfo &ChannelInfo,
+                        std::shared_ptr<Stream> &NewStream) {
   auto PVUpdateRing = std::make_shared<
       moodycamel::ConcurrentQueue<std::shared_ptr<FlatBufs::EpicsPVUpdate>>>();
   auto client = std::make_shared<T>(ChannelInfo, PVUpdateRing);
   auto EpicsClientInterfacePtr =
       std::static_pointer_cast<EpicsClient::EpicsClientInterface>(client);
-  auto stream = std::make_shared<Stream>(ChannelInfo, EpicsClientInterfacePtr,
-                                         PVUpdateRing);
-  streams.add(stream);
+  NewStream = std::make_shared<Stream>(ChannelInfo, EpicsClientInterfacePtr,
+                                       PVUpdateRing);
   return client;
 }
 
@@ -4,6 +4,7 @@
 #include "ConversionWorker.h"
 #include "MainOpt.h"
 #include "Streams.h"
+#include "TimingWheel.h"
 #include <algorithm>
 #include <atomic>
 #include <list>
@@ -35,6 +36,24 @@ enum class ForwardingStatus : int32_t {
 };
 
 class CURLReporter;
+class MetricsServer;
+
+namespace EpicsClient {
+class LoadGenerator;
+}
+
+/// Identifies the content of a file without reading it. The modification
+/// time alone has only a resolution of one second on some file systems.
+struct FileVersion {
+  /// -1 if the file can not be read.
+  int64_t Seconds = -1;
+  int64_t Nanoseconds = 0;
+  int64_t Size = 0;
+  bool operator==(FileVersion const &Other) const {
+    return Seconds == Other.Seconds && Nanoseconds == Other.Nanoseconds &&
+           Size == Other.Size;
+  }
+};
 
 enum class ForwardingRunState : int {
   RUN = 0,
@@ -48,29 +67,49 @@ public:
   ~Forwarder();
   void forward_epics_to_kafka();
   void addMapping(StreamSettings const &StreamInfo);
+  void addMappings(std::vector<StreamSettings> const &StreamsInfo);
+  void setMappings(std::vector<StreamSettings> const &StreamsInfo);
   void stopForwarding();
   void stopForwardingDueToSignal();
   void report_status();
   void report_stats(int dt);
   int conversion_workers_clear();
   int converters_clear();
-  std::unique_lock<std::mutex> get_lock_streams();
   std::unique_lock<std::mutex> get_lock_converters();
   // Public for unit tests
   Streams streams;
 
 private:
   void createFakePVUpdateTimerIfRequired();
-  void createPVUpdateTimerIfRequired();
-  template <typename T> std::shared_ptr<T> addStream(ChannelInfo &ChannelInfo);
+  void addPeriodicUpdate(std::shared_ptr<Stream> const &Stream);
+  std::string renderMetrics();
+  std::shared_ptr<Stream> createStream(StreamSettings const &StreamInfo);
+  template <typename T>
+  std::shared_ptr<T> createClient(ChannelInfo &ChannelInfo,
+                                  std::shared_ptr<Stream> &NewStream);
+  std::shared_ptr<Stream> retargetStream(Stream &Previous,
+                                         StreamSettings const &StreamInfo);
+  void reportConnectionProgress();
+  void reloadConfigFileIfChanged();
+  /// Version of the configuration file which was last applied.
+  FileVersion ConfigFileApplied;
+  /// Version of the configuration file which could not be applied. It is
+  /// tried again only after the file changed.
+  FileVersion ConfigFileFailed;
+  size_t LastConnectedCount = 0;
   MainOpt &main_opt;
   std::shared_ptr<InstanceSet> kafka_instance_set;
   std::unique_ptr<Config::Listener> config_listener;
-  std::unique_ptr<Timer> PVUpdateTimer;
   std::unique_ptr<Timer> GenerateFakePVUpdateTimer;
+  /// Serves PVs for stress tests if requested, see --load-generator.
+  std::unique_ptr<EpicsClient::LoadGenerator> LoadGenerator;
+  /// Periodic re-emission of the last update of the streams. Swept and run
+  /// by the conversion workers.
+  TimingWheel PeriodicUpdates;
+  static std::chrono::milliseconds const PeriodicUpdateResolution;
+  static size_t const PeriodicUpdateSlots;
   std::mutex converters_mutex;
   std::map<std::string, std::weak_ptr<Converter>> converters;
-  std::mutex streams_mutex;
   std::mutex conversion_workers_mx;
   std::vector<std::unique_ptr<ConversionWorker>> conversion_workers;
   ConversionScheduler conversion_scheduler;
@@ -79,6 +118,7 @@ private:
   friend class ConversionScheduler;
   std::atomic<ForwardingStatus> forwarding_status{ForwardingStatus::NORMAL};
   std::unique_ptr<CURLReporter> curl;
+  std::unique_ptr<MetricsServer> metrics_server;
   std::shared_ptr<KafkaW::Producer> status_producer;
   std::unique_ptr<KafkaW::ProducerTopic> status_producer_topic;
   std::atomic<ForwardingRunState> ForwardingRunFlag{ForwardingRunState::RUN};
@@ -5,6 +5,7 @@ namespace Forwarder {
 
 static std::mutex mx;
 static std::shared_ptr<InstanceSet> kset;
+static ProducerFactory Factory;
 
 sptr<InstanceSet> InstanceSet::Set(KafkaW::BrokerSettings BrokerSettings) {
   std::unique_lock<std::mutex> lock(mx);
@@ -21,6 +22,11 @@ void InstanceSet::clear() {
   kset.reset();
 }
 
+void InstanceSet::setProducerFactory(ProducerFactory NewFactory) {
+  std::unique_lock<std::mutex> lock(mx);
+  Factory = std::move(NewFactory);
+}
+
 InstanceSet::InstanceSet(KafkaW::BrokerSettings BrokerSettings)
     : BrokerSettings(BrokerSettings) {}
 
@@ -49,7 +55,16 @@ KafkaW::Producer::Topic InstanceSet::producer_topic(Forwarder::URI uri) {
   }
   auto BrokerSettings = this->BrokerSettings;
   BrokerSettings.Address = host_port;
-  auto p = std::make_shared<KafkaW::Producer>(BrokerSettings);
+  std::shared_ptr<KafkaW::Producer> p;
+  {
+    std::unique_lock<std::mutex> lock(mx);
+    if (Factory) {
+      p = Factory(BrokerSettings);
+    }
+  }
+  if (!p) {
+    p = std::make_shared<KafkaW::Producer>(BrokerSettings);
+  }
   p->on_delivery_ok = prod_delivery_ok;
   p->on_delivery_failed = prod_delivery_failed;
   {
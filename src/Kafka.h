@@ -8,6 +8,7 @@ Simple load balance over the available producers.
 
 #include "uri.h"
 #include <atomic>
+#include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -23,10 +24,16 @@ namespace Forwarder {
 
 template <typename T> using sptr = std::shared_ptr<T>;
 
+using ProducerFactory = std::function<std::shared_ptr<KafkaW::Producer>(
+    KafkaW::BrokerSettings)>;
+
 class InstanceSet {
 public:
   static sptr<InstanceSet> Set(KafkaW::BrokerSettings opt);
   static void clear();
+  /// Creates the producers of instance sets from now on, for example a
+  /// KafkaW::MockProducer. An empty factory restores the librdkafka producer.
+  static void setProducerFactory(ProducerFactory Factory);
   KafkaW::Producer::Topic producer_topic(URI uri);
   int poll();
   void log_stats();
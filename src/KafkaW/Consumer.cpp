@@ -208,4 +208,32 @@ PollStatus Consumer::poll() {
   }
   return PollStatus::Err();
 }
+
+std::vector<std::unique_ptr<Msg>> Consumer::pollBatch(size_t MaxMessages) {
+  std::vector<std::unique_ptr<Msg>> Messages;
+  std::vector<rd_kafka_message_t *> Batch(MaxMessages);
+  auto Queue = rd_kafka_queue_get_consumer(RdKafka);
+  auto n = rd_kafka_consume_batch_queue(
+      Queue, ConsumerBrokerSettings.PollTimeoutMS, Batch.data(), MaxMessages);
+  rd_kafka_queue_destroy(Queue);
+  if (n < 0) {
+    auto err = rd_kafka_last_error();
+    LOG(Sev::Error, "can not consume batch: {} {}", rd_kafka_err2name(err),
+        rd_kafka_err2str(err));
+    return Messages;
+  }
+  Messages.reserve(n);
+  for (ssize_t i = 0; i < n; ++i) {
+    std::unique_ptr<Msg> m2(new Msg);
+    m2->MsgPtr = Batch[i];
+    auto err = Batch[i]->err;
+    if (err == RD_KAFKA_RESP_ERR_NO_ERROR) {
+      Messages.push_back(std::move(m2));
+    } else if (err != RD_KAFKA_RESP_ERR__PARTITION_EOF) {
+      LOG(Sev::Error, "unhandled msg error: {} {}", rd_kafka_err2name(err),
+          rd_kafka_err2str(err));
+    }
+  }
+  return Messages;
+}
 }
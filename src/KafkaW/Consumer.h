@@ -5,6 +5,8 @@
 #include "PollStatus.h"
 #include <functional>
 #include <librdkafka/rdkafka.h>
+#include <memory>
+#include <vector>
 
 namespace KafkaW {
 
@@ -20,6 +22,9 @@ public:
   void addTopic(std::string Topic);
   void dumpCurrentSubscription();
   PollStatus poll();
+  /// Returns up to MaxMessages messages which are available within the poll
+  /// timeout. Errors and end of partition events are logged and skipped.
+  std::vector<std::unique_ptr<Msg>> pollBatch(size_t MaxMessages);
   std::function<void(rd_kafka_topic_partition_list_t *plist)>
       on_rebalance_assign;
   std::function<void(rd_kafka_topic_partition_list_t *plist)>
@@ -0,0 +1,104 @@
+#include "MockProducer.h"
+#include "logger.h"
+#include <cstring>
+
+namespace KafkaW {
+
+MockProducer::MockProducer(BrokerSettings ProducerBrokerSettings)
+    : Producer(ProducerBrokerSettings, WithoutRdKafka()) {
+  LOG(Sev::Info, "New mock Kafka producer for brokers: {}",
+      ProducerBrokerSettings.Address);
+}
+
+MockProducer::~MockProducer() { flush(); }
+
+void MockProducer::poll() {
+  auto Now = std::chrono::steady_clock::now();
+  std::vector<Pending> Due;
+  {
+    std::unique_lock<std::mutex> lock(Mutex);
+    while (!Queue.empty() && Queue.front().Due <= Now) {
+      Due.push_back(Queue.front());
+      Queue.pop_front();
+    }
+    Stats.out_queue = Queue.size();
+  }
+  // Without the lock, the callbacks may produce again.
+  for (auto const &Delivery : Due) {
+    deliver(Delivery);
+  }
+  Stats.poll_served += Due.size();
+}
+
+void MockProducer::flush() {
+  std::deque<Pending> All;
+  {
+    std::unique_lock<std::mutex> lock(Mutex);
+    std::swap(All, Queue);
+    Stats.out_queue = 0;
+  }
+  for (auto const &Delivery : All) {
+    deliver(Delivery);
+  }
+  Stats.poll_served += All.size();
+}
+
+void MockProducer::deliver(Pending const &Delivery) {
+  rd_kafka_message_t Message;
+  std::memset(&Message, 0, sizeof(Message));
+  Message.err = Delivery.Error;
+  Message.payload = Delivery.Message->data;
+  Message.len = Delivery.Message->size;
+  Message._private = Delivery.Message;
+  if (Delivery.Error != RD_KAFKA_RESP_ERR_NO_ERROR) {
+    if (auto &cb = on_delivery_failed) {
+      cb(&Message);
+    }
+    ++Stats.produce_cb_fail;
+  } else {
+    if (auto &cb = on_delivery_ok) {
+      cb(&Message);
+    }
+    ++Stats.produce_cb;
+  }
+}
+
+uint64_t MockProducer::outputQueueLength() {
+  std::unique_lock<std::mutex> lock(Mutex);
+  return Queue.size();
+}
+
+rd_kafka_topic_t *MockProducer::createTopic(std::string const &Name) {
+  LOG(Sev::Debug, "mock topic: {}  producer: {}", Name, id);
+  return nullptr;
+}
+
+rd_kafka_resp_err_t MockProducer::produce(rd_kafka_topic_t *Topic,
+                                          std::string const &TopicName,
+                                          Msg *Message) {
+  if (ProduceError != RD_KAFKA_RESP_ERR_NO_ERROR) {
+    return ProduceError;
+  }
+  std::unique_lock<std::mutex> lock(Mutex);
+  if (QueueCapacity > 0 && Queue.size() >= QueueCapacity) {
+    return RD_KAFKA_RESP_ERR__QUEUE_FULL;
+  }
+  ++Accepted;
+  auto Error = RD_KAFKA_RESP_ERR_NO_ERROR;
+  if (FailEveryNth > 0 && Accepted % FailEveryNth == 0) {
+    Error = RD_KAFKA_RESP_ERR__MSG_TIMED_OUT;
+  }
+  Queue.push_back({Message, std::chrono::steady_clock::now() + Latency, Error});
+  if (RecordMessages) {
+    Produced.push_back(
+        {TopicName, std::vector<uint8_t>(Message->data,
+                                         Message->data + Message->size)});
+  }
+  return RD_KAFKA_RESP_ERR_NO_ERROR;
+}
+
+std::vector<MockProducer::ProducedMessage> MockProducer::produced() {
+  std::unique_lock<std::mutex> lock(Mutex);
+  return Produced;
+}
+}
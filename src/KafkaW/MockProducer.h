@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Producer.h"
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace KafkaW {
+
+/// \brief
+/// Producer which keeps the messages in process instead of sending them to a
+/// broker.
+///
+/// Calls the delivery callbacks from poll() like the librdkafka producer
+/// does, so that throughput, backpressure and memory behavior of the
+/// forwarder can be tested and benchmarked on one machine. The settings
+/// should be made before the first message is produced.
+class MockProducer : public Producer {
+public:
+  struct ProducedMessage {
+    std::string Topic;
+    std::vector<uint8_t> Payload;
+  };
+
+  explicit MockProducer(BrokerSettings ProducerBrokerSettings_);
+  ~MockProducer() override;
+  void poll() override;
+  uint64_t outputQueueLength() override;
+  rd_kafka_topic_t *createTopic(std::string const &Name) override;
+  rd_kafka_resp_err_t produce(rd_kafka_topic_t *Topic,
+                              std::string const &TopicName,
+                              Msg *Message) override;
+  /// Delivers all queued messages without waiting for the latency.
+  void flush();
+  /// Copies of the messages which were accepted so far, if recorded.
+  std::vector<ProducedMessage> produced();
+
+  /// Time between producing a message and its delivery callback.
+  std::chrono::microseconds Latency{0};
+  /// Number of undelivered messages at which produce() fails with
+  /// QUEUE_FULL. Zero means unlimited.
+  size_t QueueCapacity = 0;
+  /// Fail the delivery of every n-th message, never if zero.
+  uint64_t FailEveryNth = 0;
+  /// If set, produce() fails with this error.
+  rd_kafka_resp_err_t ProduceError = RD_KAFKA_RESP_ERR_NO_ERROR;
+  /// Disable for benchmarks which should not hold on to all payloads.
+  bool RecordMessages = true;
+
+private:
+  struct Pending {
+    Msg *Message;
+    std::chrono::steady_clock::time_point Due;
+    rd_kafka_resp_err_t Error;
+  };
+  void deliver(Pending const &Delivery);
+  std::mutex Mutex;
+  std::deque<Pending> Queue;
+  std::vector<ProducedMessage> Produced;
+  uint64_t Accepted = 0;
+};
+}
@@ -1,4 +1,6 @@
 #include "Producer.h"
+#include "ProducerTopic.h"
+#include "TopicSettings.h"
 #include "logger.h"
 
 namespace KafkaW {
@@ -153,6 +155,11 @@ Producer::Producer(BrokerSettings ProducerBrokerSettings)
   }
 }
 
+Producer::Producer(BrokerSettings ProducerBrokerSettings, WithoutRdKafka)
+    : ProducerBrokerSettings(ProducerBrokerSettings) {
+  id = g_kafka_producer_instance_count++;
+}
+
 Producer::Producer(Producer &&x) {
   using std::swap;
   swap(RdKafkaPtr, x.RdKafkaPtr);
@@ -178,9 +185,43 @@ void Producer::poll() {
 
 void Producer::pollWhileOutputQueueFilled() {
   while (outputQueueLength() > 0) {
-    Stats.poll_served +=
-        rd_kafka_poll(RdKafkaPtr, ProducerBrokerSettings.PollTimeoutMS);
+    poll();
+  }
+}
+
+rd_kafka_topic_t *Producer::createTopic(std::string const &Name) {
+  TopicSettings TopicSettings;
+  rd_kafka_topic_conf_t *topic_conf = rd_kafka_topic_conf_new();
+  TopicSettings.applySettingsToRdKafkaConf(topic_conf);
+
+  auto RdKafkaTopic = rd_kafka_topic_new(RdKafkaPtr, Name.c_str(), topic_conf);
+  if (RdKafkaTopic == nullptr) {
+    // Seems like Kafka uses the system error code?
+    auto errstr = rd_kafka_err2str(rd_kafka_last_error());
+    LOG(Sev::Error, "could not create Kafka topic: {}", errstr);
+    throw TopicCreationError();
+  }
+  LOG(Sev::Debug, "ctor topic: {}  producer: {}",
+      rd_kafka_topic_name(RdKafkaTopic), rd_kafka_name(RdKafkaPtr));
+  return RdKafkaTopic;
+}
+
+rd_kafka_resp_err_t Producer::produce(rd_kafka_topic_t *Topic,
+                                      std::string const &TopicName,
+                                      Msg *Message) {
+  if (Topic == nullptr) {
+    // Should never happen
+    return RD_KAFKA_RESP_ERR__UNKNOWN_TOPIC;
+  }
+  int32_t partition = RD_KAFKA_PARTITION_UA;
+  void const *key = nullptr;
+  size_t key_len = 0;
+  int msgflags = 0; // 0, RD_KAFKA_MSG_F_COPY, RD_KAFKA_MSG_F_FREE
+  if (rd_kafka_produce(Topic, partition, msgflags, Message->data,
+                       Message->size, key, key_len, Message) != 0) {
+    return rd_kafka_last_error();
   }
+  return RD_KAFKA_RESP_ERR_NO_ERROR;
 }
 
 rd_kafka_t *Producer::getRdKafkaPtr() const { return RdKafkaPtr; }
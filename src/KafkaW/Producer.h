@@ -5,6 +5,7 @@
 #include <atomic>
 #include <functional>
 #include <librdkafka/rdkafka.h>
+#include <string>
 
 namespace KafkaW {
 
@@ -33,6 +34,10 @@ struct ProducerStats {
   ProducerStats(ProducerStats const &);
 };
 
+/// Produces to Kafka via librdkafka.
+///
+/// The methods which talk to librdkafka are virtual, so that a producer
+/// without a broker can stand in for it, see MockProducer.
 class Producer {
 public:
   typedef ProducerTopic Topic;
@@ -40,11 +45,21 @@ public:
   Producer(BrokerSettings ProducerBrokerSettings_);
   Producer(Producer const &) = delete;
   Producer(Producer &&x);
-  ~Producer();
+  virtual ~Producer();
   void pollWhileOutputQueueFilled();
-  void poll();
+  /// Serves the delivery callbacks.
+  virtual void poll();
   uint64_t totalMessagesProduced();
-  uint64_t outputQueueLength();
+  virtual uint64_t outputQueueLength();
+  /// Creates the librdkafka handle of a topic for ProducerTopic.
+  ///
+  /// \throws TopicCreationError
+  virtual rd_kafka_topic_t *createTopic(std::string const &Name);
+  /// Enqueues the message for delivery. On success, the message is owned by
+  /// the producer until the delivery callback was called for it.
+  virtual rd_kafka_resp_err_t produce(rd_kafka_topic_t *Topic,
+                                      std::string const &TopicName,
+                                      Msg *Message);
   static void cb_delivered(rd_kafka_t *rk, rd_kafka_message_t const *msg,
                            void *opaque);
   static void cb_error(rd_kafka_t *rk, int err_i, char const *reason,
@@ -66,7 +81,10 @@ public:
   std::atomic<uint64_t> TotalMessagesProduced{0};
   ProducerStats Stats;
 
-private:
+protected:
+  /// For producers which do not use librdkafka at all.
+  struct WithoutRdKafka {};
+  Producer(BrokerSettings ProducerBrokerSettings_, WithoutRdKafka);
   int id = 0;
 };
 }
@@ -23,21 +23,7 @@ ProducerTopic::~ProducerTopic() {
 ProducerTopic::ProducerTopic(std::shared_ptr<Producer> Producer,
                              std::string Name_)
     : Producer_(Producer), Name(Name_) {
-  TopicSettings TopicSettings;
-  rd_kafka_topic_conf_t *topic_conf = rd_kafka_topic_conf_new();
-  TopicSettings.applySettingsToRdKafkaConf(topic_conf);
-
-  RdKafkaTopic =
-      rd_kafka_topic_new(Producer_->getRdKafkaPtr(), Name.c_str(), topic_conf);
-  if (RdKafkaTopic == nullptr) {
-    // Seems like Kafka uses the system error code?
-    auto errstr = rd_kafka_err2str(rd_kafka_last_error());
-    LOG(Sev::Error, "could not create Kafka topic: {}", errstr);
-    throw TopicCreationError();
-  }
-  LOG(Sev::Debug, "ctor topic: {}  producer: {}",
-      rd_kafka_topic_name(RdKafkaTopic),
-      rd_kafka_name(Producer_->getRdKafkaPtr()));
+  RdKafkaTopic = Producer_->createTopic(Name);
 }
 
 ProducerTopic::ProducerTopic(ProducerTopic &&x) {
@@ -64,39 +50,29 @@ int ProducerTopic::produce(uchar *MsgData, size_t MsgSize, bool PrintError) {
 }
 
 int ProducerTopic::produce(unique_ptr<Producer::Msg> &Msg) {
-  if (!RdKafkaTopic) {
-    // Should never happen
-    return RDKAFKATOPIC_NOT_INITIALIZED;
-  }
-  int x;
-  int32_t partition = RD_KAFKA_PARTITION_UA;
-  void const *key = nullptr;
-  size_t key_len = 0;
-  int msgflags = 0; // 0, RD_KAFKA_MSG_F_COPY, RD_KAFKA_MSG_F_FREE
-  x = rd_kafka_produce(RdKafkaTopic, partition, msgflags, Msg->data, Msg->size,
-                       key, key_len, Msg.get());
+  int x = 0;
+  auto err = Producer_->produce(RdKafkaTopic, Name, Msg.get());
 
   auto &s = Producer_->Stats;
-  if (x != 0) {
-    auto err = rd_kafka_last_error();
+  if (err != RD_KAFKA_RESP_ERR_NO_ERROR) {
+    x = -1;
     bool print_err = true;
     if (err == RD_KAFKA_RESP_ERR__QUEUE_FULL) {
       ++s.local_queue_full;
       if (print_err) {
-        LOG(Sev::Warning, "QUEUE_FULL  outq: {}",
-            rd_kafka_outq_len(Producer_->getRdKafkaPtr()));
+        LOG_LIMITED(Sev::Warning, "QUEUE_FULL  outq: {}",
+                    Producer_->outputQueueLength());
       }
     } else if (err == RD_KAFKA_RESP_ERR_MSG_SIZE_TOO_LARGE) {
       ++s.msg_too_large;
       if (print_err) {
-        LOG(Sev::Error, "TOO_LARGE  size: {}", Msg->size);
+        LOG_LIMITED(Sev::Error, "TOO_LARGE  size: {}", Msg->size);
       }
     } else {
       ++s.produce_fail;
       if (print_err) {
-        LOG(Sev::Debug, "produce topic {}  partition {}   error: {}  {}",
-            rd_kafka_topic_name(RdKafkaTopic), partition, x,
-            rd_kafka_err2str(err));
+        LOG_LIMITED(Sev::Debug, "produce topic {}  error: {}  {}", Name,
+                    err, rd_kafka_err2str(err));
       }
     }
   } else {
@@ -104,8 +80,7 @@ int ProducerTopic::produce(unique_ptr<Producer::Msg> &Msg) {
     s.produced_bytes += (uint64_t)Msg->size;
     ++Producer_->TotalMessagesProduced;
     if (log_level >= 8) {
-      LOG(Sev::Debug, "sent to topic {} partition {}",
-          rd_kafka_topic_name(RdKafkaTopic), partition);
+      LOG(Sev::Debug, "sent to topic {}", Name);
     }
     Msg.release();
   }
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "KafkaW/Producer.h"
+#include <atomic>
+#include <concurrentqueue/concurrentqueue.h>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// adhoc namespace because it would now collide with ::Logger defined
+// in gralog_logger
+
+namespace DW {
+
+/// A log message which is waiting to be written.
+struct LogRecord {
+  int level;
+  int color;
+  char const *file;
+  int line;
+  std::string message;
+};
+
+/// \brief
+/// Writes the log messages from a background thread.
+///
+/// The caller only formats the message itself and enqueues it. Each thread
+/// gets its own sub-queue, so logging threads do not contend with each other.
+/// Decorating, writing to the log file and shipping to Kafka or Graylog is
+/// done by the writer thread. If the writer can not keep up, new messages are
+/// dropped and the number of dropped messages is logged. Errors and more
+/// severe messages are never dropped, they are written directly.
+class Logger {
+public:
+  Logger();
+  ~Logger();
+  void use_log_file(std::string fname);
+  void log_kafka_gelf_start(std::string broker, std::string topic);
+  void log_kafka_gelf_stop();
+  FILE *log_file = stdout;
+  int is_tty = 1;
+  void dwlog_inner(int level, int color, char const *file, int line,
+                   char const *func, std::string const &s1);
+  int prefix_len();
+  void fwd_graylog_logger_enable(std::string address);
+  /// Stops the writer thread and writes the queued messages. Messages logged
+  /// from then on are written directly.
+  void stopWriter();
+
+private:
+  void write(LogRecord const &Record);
+  void runWriter();
+  size_t drain();
+  /// drain() with WriteMutex already held.
+  size_t drainLocked();
+  static size_t const MaxQueuedRecords = 64 * 1024;
+  moodycamel::ConcurrentQueue<LogRecord> Queue;
+  std::atomic<size_t> Queued{0};
+  std::atomic<uint64_t> Dropped{0};
+  std::atomic<bool> WriterRunning{false};
+  std::thread WriterThread;
+  /// Serializes the writer thread and direct writes on the log file.
+  std::mutex WriteMutex;
+  std::atomic<bool> do_run_kafka{false};
+  std::atomic<bool> do_use_graylog_logger{false};
+  std::shared_ptr<KafkaW::Producer> producer;
+  std::unique_ptr<KafkaW::Producer::Topic> topic;
+  std::thread thread_poll;
+};
+}
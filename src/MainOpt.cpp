@@ -13,6 +13,8 @@
 #include <CLI/CLI.hpp>
 #include <fstream>
 #include <iostream>
+#include <pv/pvIntrospect.h>
+#include <stdexcept>
 #include <streambuf>
 
 namespace Forwarder {
@@ -102,6 +104,9 @@ std::pair<int, std::unique_ptr<MainOpt>> parse_opt(int argc, char **argv) {
   std::string BrokerDataDefault;
   App.add_option("--config-file", opt.ConfigurationFile,
                  "Configuration JSON file");
+  App.add_flag("--watch-config-file", opt.WatchConfigFile,
+               "Apply changed streams of the configuration file without "
+               "restart");
   App.add_option("--log-file", opt.LogFilename, "Log filename");
   App.add_option("--broker", BrokerDataDefault, "Default broker for data");
   App.add_option("--kafka-gelf", opt.KafkaGELFAddress,
@@ -109,6 +114,9 @@ std::pair<int, std::unique_ptr<MainOpt>> parse_opt(int argc, char **argv) {
   App.add_option("--graylog-logger-address", opt.GraylogLoggerAddress,
                  "Address for Graylog logging");
   App.add_option("--influx-url", opt.InfluxURI, "Address for Influx logging");
+  App.add_option("--metrics-port", opt.MetricsPort,
+                 "Serve metrics for Prometheus over HTTP on this port. 0=Off",
+                 true);
   App.add_option("-v,--verbose", log_level, "Syslog logging level", true)
       ->check(CLI::Range(1, 7));
   addOption(App, "--broker-config", opt.MainSettings.BrokerConfig,
@@ -127,6 +135,30 @@ std::pair<int, std::unique_ptr<MainOpt>> parse_opt(int argc, char **argv) {
                  "instead of forwarding real "
                  "PV updates from EPICS",
                  true);
+  App.add_option("--fake-pv-type", opt.FakePV.Type,
+                 "pvData scalar type of the fake PV values", true);
+  App.add_option("--fake-pv-array-size", opt.FakePV.ArraySize,
+                 "Number of elements of the fake PV values. 0=Scalar", true);
+  std::string FakePVArrival = "periodic";
+  App.add_option("--fake-pv-arrival", FakePVArrival,
+                 "Arrival pattern of the fake PV updates: periodic, poisson "
+                 "or bursty",
+                 true);
+  App.add_option("--fake-pv-updates-per-period", opt.FakePV.UpdatesPerPeriod,
+                 "Mean number of fake PV updates per period", true);
+  App.add_option("--fake-pv-burst-size", opt.FakePV.BurstSize,
+                 "Number of fake PV updates per burst", true);
+  std::vector<std::string> LoadGeneratorGroups;
+  App.add_option("--load-generator", LoadGeneratorGroups,
+                 "<type>,<count>,<array size>,<period ms> Serve PVs with "
+                 "generated values over pvAccess from within the process. "
+                 "Can be given more than once");
+  App.add_option("--load-generator-prefix", opt.LoadGeneratorPrefix,
+                 "Prefix of the channel names of the load generator", true);
+  // Hidden, only useful to benchmark the forwarder without brokers.
+  App.add_flag("--mock-kafka", opt.MockKafka,
+               "Produce to in-process mock producers instead of Kafka")
+      ->group("");
 
   try {
     App.parse(argc, argv);
@@ -140,6 +172,31 @@ std::pair<int, std::unique_ptr<MainOpt>> parse_opt(int argc, char **argv) {
     std::cout << App.help();
     return ret;
   }
+  try {
+    epics::pvData::ScalarTypeFunc::getScalarType(opt.FakePV.Type);
+  } catch (std::exception const &) {
+    LOG(3, "Can not parse command line options: unknown type {}",
+        opt.FakePV.Type);
+    ret.first = 1;
+    return ret;
+  }
+  try {
+    opt.FakePV.Arrival = EpicsClient::parseFakePVArrival(FakePVArrival);
+    if (opt.FakePV.Arrival == EpicsClient::FakePVArrival::Bursty &&
+        opt.FakePV.UpdatesPerPeriod > opt.FakePV.BurstSize) {
+      throw std::runtime_error(
+          "Bursty fake PVs need --fake-pv-burst-size of at least "
+          "--fake-pv-updates-per-period");
+    }
+    for (auto const &Group : LoadGeneratorGroups) {
+      opt.LoadGeneratorGroups.push_back(
+          EpicsClient::parseLoadGeneratorGroup(Group));
+    }
+  } catch (std::runtime_error const &e) {
+    LOG(3, "Can not parse command line options: {}", e.what());
+    ret.first = 1;
+    return ret;
+  }
   if (!opt.ConfigurationFile.empty()) {
     try {
       opt.parse_json_file(opt.ConfigurationFile);
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "ConfigParser.h"
+#include "EpicsClient/FakePVSettings.h"
+#include "EpicsClient/LoadGeneratorGroup.h"
 #include "KafkaW/KafkaW.h"
 #include "SchemaRegistry.h"
 #include "uri.h"
@@ -18,8 +20,17 @@ struct MainOpt {
   std::string InfluxURI = "";
   std::string LogFilename;
   std::string ConfigurationFile;
+  /// Apply changes of the streams in the configuration file while running.
+  bool WatchConfigFile = false;
   uint32_t PeriodMS = 0;
   uint32_t FakePVPeriodMS = 0;
+  EpicsClient::FakePVSettings FakePV;
+  /// PVs served by the in-process load generator, none if empty.
+  std::vector<EpicsClient::LoadGeneratorGroup> LoadGeneratorGroups;
+  std::string LoadGeneratorPrefix = "FwdLoad:";
+  uint16_t MetricsPort = 0;
+  /// Produce to in-process mock producers instead of Kafka, for benchmarks.
+  bool MockKafka = false;
   uint64_t teamid = 0;
   std::vector<char> Hostname;
   FlatBufs::SchemaRegistry schema_registry;
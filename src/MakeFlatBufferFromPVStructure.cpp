@@ -8,6 +8,12 @@ void MakeFlatBufferFromPVStructure::config(
     std::map<std::string, int64_t> const &config_ints,
     std::map<std::string, std::string> const &config_strings) {}
 
+FlatBufs::FlatbufferMessage::uptr
+MakeFlatBufferFromPVStructure::convertWithSizeHint(EpicsPVUpdate const &up,
+                                                   uint32_t InitialSize) {
+  return convert(up);
+}
+
 std::map<std::string, double> MakeFlatBufferFromPVStructure::stats() {
   return {};
 }
@@ -17,6 +17,11 @@ public:
   virtual ~MakeFlatBufferFromPVStructure();
   virtual FlatBufs::FlatbufferMessage::uptr
   convert(EpicsPVUpdate const &up) = 0;
+  /// Converts into a message whose builder starts with InitialSize bytes, so
+  /// that large messages do not grow the builder several times. The default
+  /// ignores the size.
+  virtual FlatBufs::FlatbufferMessage::uptr
+  convertWithSizeHint(EpicsPVUpdate const &up, uint32_t InitialSize);
   virtual void config(std::map<std::string, int64_t> const &config_ints,
                       std::map<std::string, std::string> const &config_strings);
   virtual std::map<std::string, double> stats();
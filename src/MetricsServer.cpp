@@ -0,0 +1,160 @@
+#include "MetricsServer.h"
+#include "logger.h"
+#ifndef _MSC_VER
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace Forwarder {
+
+std::string MetricsServer::escapeLabelValue(std::string const &Value) {
+  std::string Escaped;
+  Escaped.reserve(Value.size());
+  for (auto c : Value) {
+    if (c == '\\' || c == '"') {
+      Escaped.push_back('\\');
+      Escaped.push_back(c);
+    } else if (c == '\n') {
+      Escaped.append("\\n");
+    } else {
+      Escaped.push_back(c);
+    }
+  }
+  return Escaped;
+}
+
+void MetricsServer::setSnapshot(std::string NewSnapshot) {
+  std::unique_lock<std::mutex> lock(SnapshotMutex);
+  Snapshot.swap(NewSnapshot);
+}
+
+uint16_t MetricsServer::port() const { return Port; }
+
+MetricsServer::~MetricsServer() { stop(); }
+
+#ifndef _MSC_VER
+bool const MetricsServer::HaveMetricsServer = true;
+
+MetricsServer::MetricsServer(uint16_t Port) : Port(Port) {}
+
+int MetricsServer::start() {
+  ListenSocket = socket(AF_INET, SOCK_STREAM, 0);
+  if (ListenSocket < 0) {
+    LOG(3, "Can not create metrics socket: {}", strerror(errno));
+    return -1;
+  }
+  int Reuse = 1;
+  setsockopt(ListenSocket, SOL_SOCKET, SO_REUSEADDR, &Reuse, sizeof(Reuse));
+  sockaddr_in Address;
+  std::memset(&Address, 0, sizeof(Address));
+  Address.sin_family = AF_INET;
+  Address.sin_addr.s_addr = htonl(INADDR_ANY);
+  Address.sin_port = htons(Port);
+  if (bind(ListenSocket, reinterpret_cast<sockaddr *>(&Address),
+           sizeof(Address)) != 0 ||
+      listen(ListenSocket, 8) != 0) {
+    LOG(3, "Can not listen for metrics on port {}: {}", Port,
+        strerror(errno));
+    close(ListenSocket);
+    ListenSocket = -1;
+    return -1;
+  }
+  socklen_t AddressLength = sizeof(Address);
+  getsockname(ListenSocket, reinterpret_cast<sockaddr *>(&Address),
+              &AddressLength);
+  Port = ntohs(Address.sin_port);
+  Running = true;
+  ServerThread = std::thread([this] { run(); });
+  LOG(6, "Serving metrics on port {}", Port);
+  return 0;
+}
+
+void MetricsServer::stop() {
+  Running = false;
+  if (ServerThread.joinable()) {
+    ServerThread.join();
+  }
+  if (ListenSocket >= 0) {
+    close(ListenSocket);
+    ListenSocket = -1;
+  }
+}
+
+void MetricsServer::run() {
+  while (Running.load()) {
+    pollfd Poll{ListenSocket, POLLIN, 0};
+    // Wake up regularly to notice a stop request.
+    auto Ready = poll(&Poll, 1, 100);
+    if (Ready <= 0) {
+      continue;
+    }
+    auto Socket = accept(ListenSocket, nullptr, nullptr);
+    if (Socket < 0) {
+      continue;
+    }
+    serveConnection(Socket);
+    close(Socket);
+  }
+}
+
+void MetricsServer::serveConnection(int Socket) {
+  // A scraper which does not send its request in time is dropped so that it
+  // can not stall other scrapes.
+  timeval Timeout{1, 0};
+  setsockopt(Socket, SOL_SOCKET, SO_RCVTIMEO, &Timeout, sizeof(Timeout));
+  setsockopt(Socket, SOL_SOCKET, SO_SNDTIMEO, &Timeout, sizeof(Timeout));
+  std::string Request;
+  char Buffer[1024];
+  while (Request.find("\r\n\r\n") == std::string::npos &&
+         Request.size() < 16 * 1024) {
+    auto n = recv(Socket, Buffer, sizeof(Buffer), 0);
+    if (n <= 0) {
+      return;
+    }
+    Request.append(Buffer, n);
+  }
+  std::string Body;
+  {
+    std::unique_lock<std::mutex> lock(SnapshotMutex);
+    Body = Snapshot;
+  }
+  auto Response = fmt::format("HTTP/1.0 200 OK\r\n"
+                              "Content-Type: text/plain; version=0.0.4\r\n"
+                              "Content-Length: {}\r\n"
+                              "Connection: close\r\n\r\n",
+                              Body.size());
+  Response.append(Body);
+  size_t Sent = 0;
+  while (Sent < Response.size()) {
+    auto n = send(Socket, Response.data() + Sent, Response.size() - Sent,
+                  MSG_NOSIGNAL);
+    if (n <= 0) {
+      return;
+    }
+    Sent += n;
+  }
+}
+
+#else
+bool const MetricsServer::HaveMetricsServer = false;
+
+MetricsServer::MetricsServer(uint16_t Port) : Port(Port) {}
+
+int MetricsServer::start() {
+  LOG(3, "Metrics server is not supported on this platform");
+  return -1;
+}
+
+void MetricsServer::stop() {}
+
+void MetricsServer::run() {}
+
+void MetricsServer::serveConnection(int Socket) {}
+
+#endif
+}
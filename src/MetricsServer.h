@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Forwarder {
+
+/// \brief
+/// Serves a snapshot of the forwarder metrics over HTTP for scraping by
+/// Prometheus.
+///
+/// The snapshot is rendered by the main loop and only swapped in here, so a
+/// scrape never touches the forwarding state. Every request on the port is
+/// answered with the current snapshot in the Prometheus text format.
+
+class MetricsServer {
+public:
+  /// Set to false on platforms where the server is not implemented.
+  static bool const HaveMetricsServer;
+  /// Binds to the given port on all interfaces. Port 0 binds to an ephemeral
+  /// port which can be retrieved via port().
+  explicit MetricsServer(uint16_t Port);
+  ~MetricsServer();
+  /// Starts the listener thread. Returns 0 on success.
+  int start();
+  void stop();
+  uint16_t port() const;
+  /// Replaces the snapshot which is served to subsequent requests.
+  void setSnapshot(std::string Snapshot);
+  /// Escapes a string for use as a label value.
+  static std::string escapeLabelValue(std::string const &Value);
+
+private:
+  void run();
+  void serveConnection(int Socket);
+  uint16_t Port;
+  int ListenSocket = -1;
+  std::atomic<bool> Running{false};
+  std::thread ServerThread;
+  std::mutex SnapshotMutex;
+  std::string Snapshot;
+};
+}
@@ -1,10 +1,13 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <fmt/format.h>
+#include <iterator>
 #include <memory>
 #include <mutex>
 #include <set>
+#include <vector>
 
 /// Represents an inclusive range.
 template <typename T> class Range {
@@ -55,38 +58,58 @@ template <typename T> inline void minmax(T *mm, T const &x) {
   }
 }
 
+/// \brief
 /// A set of continuous inclusive ranges.
+///
+/// Adjacent ranges are merged on insert by looking only at the neighbours of
+/// the new value, so an insert is O(log n). The highest range is kept
+/// separately and extending it by the next value in order only needs a
+/// compare-and-swap, which makes the common case of tracking an in-order
+/// sequence lock-free.
 template <typename T> class RangeSet {
 public:
   void insert(T k) {
-    std::unique_lock<std::mutex> lock(mx);
-    set.emplace(k, k);
-    while (true) {
-      auto a1 = std::adjacent_find(set.begin(), set.end(), is_gapless<T>);
-      if (a1 == set.end()) {
-        break;
-      } else {
-        auto a2 = a1;
-        ++a2;
-        auto a3 = merge(*a1, *a2);
-        set.erase(a1);
-        set.erase(a2);
-        set.insert(a3);
+    if (HasTail.load(std::memory_order_acquire)) {
+      auto b = TailB.load();
+      if (k == b + 1 && TailB.compare_exchange_strong(b, k)) {
+        return;
       }
     }
+    std::unique_lock<std::mutex> lock(mx);
+    insertLocked(k);
   }
 
+  /// The number of disjoint ranges.
   size_t size() {
     std::unique_lock<std::mutex> lock(mx);
-    return set.size();
+    return set.size() + (HasTail.load() ? 1 : 0);
   }
 
-  std::string to_string() {
+  /// Get the highest inserted value. Returns false if the set is empty.
+  bool max(T &Max) {
+    if (!HasTail.load(std::memory_order_acquire)) {
+      return false;
+    }
+    Max = TailB.load();
+    return true;
+  }
+
+  /// Copy of the ranges in ascending order.
+  std::vector<Range<T>> ranges() {
     std::unique_lock<std::mutex> lock(mx);
+    std::vector<Range<T>> Ranges(set.begin(), set.end());
+    if (HasTail.load()) {
+      Ranges.emplace_back(TailA, TailB.load());
+    }
+    return Ranges;
+  }
+
+  std::string to_string() {
+    auto Ranges = ranges();
     fmt::MemoryWriter mw;
     mw.write("[");
     int i1 = 0;
-    for (auto &x : set) {
+    for (auto &x : Ranges) {
       if (i1 > 0) {
         mw.write(", ");
       }
@@ -101,6 +124,82 @@ public:
     return std::string(mw.c_str());
   }
 
+private:
+  void insertLocked(T k) {
+    if (!HasTail.load()) {
+      TailA = k;
+      TailB.store(k);
+      HasTail.store(true, std::memory_order_release);
+      return;
+    }
+    while (true) {
+      auto b = TailB.load();
+      if (k >= TailA && k <= b) {
+        return;
+      }
+      if (k == b + 1) {
+        if (TailB.compare_exchange_strong(b, k)) {
+          return;
+        }
+        continue;
+      }
+      if (k > b) {
+        // Start a new highest range. The old one is only final once no
+        // concurrent in-order insert has extended it in the meantime.
+        auto Old = set.emplace_hint(set.end(), TailA, b);
+        if (TailB.compare_exchange_strong(b, k)) {
+          TailA = k;
+          return;
+        }
+        set.erase(Old);
+        continue;
+      }
+      break;
+    }
+    if (k + 1 == TailA) {
+      TailA = k;
+      if (!set.empty()) {
+        auto Last = std::prev(set.end());
+        if (Last->b + 1 == TailA) {
+          TailA = Last->a;
+          set.erase(Last);
+        }
+      }
+      return;
+    }
+    insertBelowTail(k);
+  }
+
+  void insertBelowTail(T k) {
+    auto a = k;
+    auto b = k;
+    auto Next = set.lower_bound(Range<T>(k, k));
+    if (Next != set.end() && Next->a == k) {
+      return;
+    }
+    if (Next != set.begin()) {
+      auto Prev = std::prev(Next);
+      if (Prev->b >= k) {
+        return;
+      }
+      if (Prev->b + 1 == k) {
+        a = Prev->a;
+        set.erase(Prev);
+      }
+    }
+    if (Next != set.end() && Next->a == k + 1) {
+      b = Next->b;
+      Next = set.erase(Next);
+    }
+    set.emplace_hint(Next, a, b);
+  }
+
+  /// All ranges below the highest one.
   std::set<Range<T>> set;
+  /// The highest range is [TailA, TailB]. TailA is only accessed under the
+  /// mutex, TailB is extended lock-free by in-order inserts.
+  T TailA{};
+  std::atomic<T> TailB{};
+  std::atomic<bool> HasTail{false};
   std::mutex mx;
 };
@@ -0,0 +1,26 @@
+#include "SequenceLossDetector.h"
+
+namespace Forwarder {
+
+void SequenceLossDetector::next(uint64_t Seq) {
+  if (!HaveLast) {
+    HaveLast = true;
+    Last = Seq;
+    return;
+  }
+  if (Seq > Last) {
+    Missing += Seq - Last - 1;
+    Last = Seq;
+  } else {
+    ++Repeated;
+  }
+}
+
+void SequenceLossDetector::restart(uint64_t Seq) {
+  if (HaveLast) {
+    ++Restarts;
+  }
+  HaveLast = true;
+  Last = Seq;
+}
+}
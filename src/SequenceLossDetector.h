@@ -0,0 +1,34 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace Forwarder {
+
+/// \brief
+/// Counts gaps in a sequence of forwarding sequence numbers.
+///
+/// Sequence numbers are expected to increase by one. A jump forward counts the
+/// skipped numbers as missing, a number which is not larger than the last one
+/// is counted as repeated. A new sequence, for example after a reconnect of
+/// the monitor, has to be started with restart().
+/// next() and restart() must not be called concurrently, the counters can be
+/// read from any thread.
+
+class SequenceLossDetector {
+public:
+  void next(uint64_t Seq);
+  /// Starts a new sequence at Seq without counting anything as missing.
+  void restart(uint64_t Seq);
+  uint64_t missing() const { return Missing.load(); }
+  uint64_t repeated() const { return Repeated.load(); }
+  uint64_t restarts() const { return Restarts.load(); }
+
+private:
+  bool HaveLast = false;
+  uint64_t Last = 0;
+  std::atomic<uint64_t> Missing{0};
+  std::atomic<uint64_t> Repeated{0};
+  std::atomic<uint64_t> Restarts{0};
+};
+}
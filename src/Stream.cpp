@@ -5,35 +5,155 @@
 #include "KafkaOutput.h"
 #include "helper.h"
 #include "logger.h"
+#include <cmath>
 
 namespace Forwarder {
 
+/// Time constant of the moving averages in seconds.
+static double const StatisticsRateTimeConstant = 10.0;
+
+/// The moving average of the message size gives 1/2^N weight to the newest
+/// message.
+static int const MessageSizeAverageShift = 3;
+
+/// Headroom of the builder above the average message size in bytes, in
+/// addition to one eighth of the average.
+static uint32_t const MessageSizeHeadroom = 64;
+
+/// Update the moving averages from the counters accumulated since the last
+/// call. Only to be called from a single thread.
+void StreamStatistics::updateRates(std::chrono::steady_clock::time_point Now) {
+  auto Produced = UpdatesProduced.load();
+  auto Bytes = BytesProduced.load();
+  if (HaveRateBaseline) {
+    auto Dt = std::chrono::duration<double>(Now - LastRateUpdate).count();
+    if (Dt <= 0) {
+      return;
+    }
+    auto Alpha = 1.0 - std::exp(-Dt / StatisticsRateTimeConstant);
+    auto UpdateRate = (Produced - LastUpdatesProduced) / Dt;
+    auto ByteRate = (Bytes - LastBytesProduced) / Dt;
+    auto OldUpdateRate = UpdatesPerSecond.load();
+    auto OldByteRate = BytesPerSecond.load();
+    UpdatesPerSecond.store(OldUpdateRate +
+                           Alpha * (UpdateRate - OldUpdateRate));
+    BytesPerSecond.store(OldByteRate + Alpha * (ByteRate - OldByteRate));
+  }
+  HaveRateBaseline = true;
+  LastRateUpdate = Now;
+  LastUpdatesProduced = Produced;
+  LastBytesProduced = Bytes;
+}
+
+nlohmann::json StreamStatistics::to_json() const {
+  using nlohmann::json;
+  auto Document = json::object();
+  Document["updates_received"] = UpdatesReceived.load();
+  Document["updates_converted"] = UpdatesConverted.load();
+  Document["updates_produced"] = UpdatesProduced.load();
+  Document["updates_dropped"] = UpdatesDropped.load();
+  Document["bytes_produced"] = BytesProduced.load();
+  Document["updates_repeated"] = UpdatesRepeated.load();
+  Document["produce_failed"] = ProduceFailed.load();
+  Document["delivered"] = Delivered.load();
+  Document["delivery_failed"] = DeliveryFailed.load();
+  Document["updates_per_second"] = UpdatesPerSecond.load();
+  Document["bytes_per_second"] = BytesPerSecond.load();
+  return Document;
+}
+
+void StreamStatistics::deliveryOk() { ++Delivered; }
+
+void StreamStatistics::deliveryFailed() { ++DeliveryFailed; }
+
 ConversionPath::ConversionPath(ConversionPath &&x)
     : converter(std::move(x.converter)),
-      kafka_output(std::move(x.kafka_output)) {}
+      kafka_output(std::move(x.kafka_output)),
+      Statistics(std::move(x.Statistics)) {}
 
 ConversionPath::ConversionPath(std::shared_ptr<Converter> conv,
-                               std::unique_ptr<KafkaOutput> ko)
-    : converter(conv), kafka_output(std::move(ko)) {}
+                               std::unique_ptr<KafkaOutput> ko,
+                               std::shared_ptr<StreamStatistics> Statistics)
+    : converter(conv), kafka_output(std::move(ko)),
+      Statistics(std::move(Statistics)) {}
 
 ConversionPath::~ConversionPath() {
   LOG(7, "~ConversionPath");
-  while (true) {
-    auto x = transit.load();
-    if (x == 0)
-      break;
-    CLOG(7, 1, "~ConversionPath  still has transit {}", transit);
-    sleep_ms(1000);
+  // Streams are only destroyed by Streams::reclaim once nothing is in flight.
+  if (transit.load() != 0) {
+    LOG(3, "~ConversionPath  still has transit {}", transit.load());
+  }
+}
+
+/// A repeated update is converted once and the serialized flatbuffer is
+/// kept, so that the periodic repeats of a value which did not change only
+/// produce the same bytes again. A repeated update is the same object as
+/// the original update, so the result would be identical anyway.
+FlatBufs::FlatbufferMessage::uptr ConversionPath::convert(
+    std::shared_ptr<FlatBufs::EpicsPVUpdate> const &Update) {
+  if (!Update->Repeated) {
+    return convertSized(*Update);
+  }
+  auto Cached = std::atomic_load(&LastRepeat);
+  if (Cached && Cached->Update.lock() == Update) {
+    ++Statistics->UpdatesRepeated;
+    return ::make_unique<FlatBufs::FlatbufferMessage>(Cached->Message);
+  }
+  auto Message = convertSized(*Update);
+  if (Message != nullptr) {
+    auto Slice = Message->message();
+    auto Entry = std::make_shared<RepeatCache>();
+    Entry->Update = Update;
+    Entry->Message = std::make_shared<std::vector<uint8_t> const>(
+        Slice.data, Slice.data + Slice.size);
+    std::atomic_store(&LastRepeat,
+                      std::shared_ptr<RepeatCache const>(std::move(Entry)));
   }
+  return Message;
+}
+
+/// Messages of a channel usually have about the same size, so the builder
+/// starts with a bit more than the average size. Large array messages are
+/// then written with a single allocation instead of growing the builder
+/// several times.
+FlatBufs::FlatbufferMessage::uptr
+ConversionPath::convertSized(FlatBufs::EpicsPVUpdate const &Update) {
+  int64_t Average = MessageSize.load(std::memory_order_relaxed);
+  uint32_t InitialSize = 0;
+  if (Average > 0) {
+    InitialSize = static_cast<uint32_t>(Average + Average / 8 +
+                                        MessageSizeHeadroom);
+  }
+  auto Message = converter->convert(Update, InitialSize);
+  if (Message != nullptr) {
+    int64_t Size = Message->message().size;
+    if (Average > 0) {
+      Size = Average + (Size - Average) / (1 << MessageSizeAverageShift);
+    }
+    // Concurrent conversions can lose an update of the average, which does
+    // not matter for a size hint.
+    MessageSize.store(static_cast<uint32_t>(Size), std::memory_order_relaxed);
+  }
+  return Message;
 }
 
 int ConversionPath::emit(std::shared_ptr<FlatBufs::EpicsPVUpdate> up) {
-  auto fb = converter->convert(*up);
+  auto fb = convert(up);
   if (fb == nullptr) {
-    CLOG(6, 1, "empty converted flat buffer");
+    LOG_LIMITED(6, "empty converted flat buffer");
+    ++Statistics->UpdatesDropped;
+    return 1;
+  }
+  ++Statistics->UpdatesConverted;
+  auto Size = fb->message().size;
+  fb->Observer = Statistics;
+  if (kafka_output->emit(std::move(fb)) != 0) {
+    ++Statistics->UpdatesDropped;
+    ++Statistics->ProduceFailed;
     return 1;
   }
-  kafka_output->emit(std::move(fb));
+  ++Statistics->UpdatesProduced;
+  Statistics->BytesProduced += Size;
   return 0;
 }
 
@@ -44,6 +164,7 @@ nlohmann::json ConversionPath::status_json() const {
   Document["broker"] =
       kafka_output->pt.Producer_->ProducerBrokerSettings.Address;
   Document["topic"] = kafka_output->topic_name();
+  Document["average_message_size"] = MessageSize.load();
   return Document;
 }
 
@@ -54,7 +175,12 @@ Stream::Stream(
         moodycamel::ConcurrentQueue<std::shared_ptr<FlatBufs::EpicsPVUpdate>>>
         ring)
     : channel_info_(channel_info), epics_client(std::move(client)),
-      emit_queue(ring) {}
+      emit_queue(ring), Statistics(std::make_shared<StreamStatistics>()) {}
+
+Stream::Stream(Stream &Previous)
+    : channel_info_(Previous.channel_info_),
+      epics_client(Previous.epics_client), emit_queue(Previous.emit_queue),
+      Statistics(Previous.Statistics) {}
 
 Stream::~Stream() {
   CLOG(7, 2, "~Stream");
@@ -67,12 +193,16 @@ int Stream::converter_add(InstanceSet &kset, Converter::sptr conv,
                           URI uri_kafka_output) {
   auto pt = kset.producer_topic(uri_kafka_output);
   std::unique_ptr<ConversionPath> cp = ::make_unique<ConversionPath>(
-      std::move(conv), ::make_unique<KafkaOutput>(std::move(pt)));
+      std::move(conv), ::make_unique<KafkaOutput>(std::move(pt)), Statistics);
   conversion_paths.push_back(std::move(cp));
   return 0;
 }
 
-void Stream::error_in_epics() { epics_client->errorInEpics(); }
+void Stream::error_in_epics() {
+  if (epics_client != nullptr) {
+    epics_client->errorInEpics();
+  }
+}
 
 int32_t Stream::fill_conversion_work(
     moodycamel::ConcurrentQueue<std::unique_ptr<ConversionWorkPacket>> &q2,
@@ -81,41 +211,50 @@ int32_t Stream::fill_conversion_work(
   uint32_t n1 = 0;
   auto BufferSize = emit_queue->size_approx();
   auto ConversionPathSize = conversion_paths.size();
-  std::vector<ConversionWorkPacket *> cwp_last(conversion_paths.size());
-  while (n0 < BufferSize && max - n1 >= ConversionPathSize) {
+  bool QueueFull = false;
+  while (!QueueFull && n0 < BufferSize && max - n1 >= ConversionPathSize) {
     std::shared_ptr<FlatBufs::EpicsPVUpdate> EpicsUpdate;
     auto found = emit_queue->try_dequeue(EpicsUpdate);
     n0 += 1;
     if (!found) {
-      CLOG(6, 1, "Conversion worker buffer is empty");
+      LOG_LIMITED(6, "Conversion worker buffer is empty");
       break;
     }
     if (!EpicsUpdate) {
-      LOG(6, "Empty EPICS PV update");
+      LOG_LIMITED(6, "Empty EPICS PV update");
       continue;
     }
+    ++Statistics->UpdatesReceived;
+    if (!EpicsUpdate->Repeated || EpicsUpdate != LastAccounted) {
+      seq_data_emitted.insert(EpicsUpdate->seq_fwd);
+      if (EpicsUpdate->SequenceStart) {
+        IngestLoss.restart(EpicsUpdate->seq_fwd);
+      } else {
+        IngestLoss.next(EpicsUpdate->seq_fwd);
+      }
+      LastAccounted = EpicsUpdate;
+    }
     size_t ConversionPathID = 0;
     on_seq_data(EpicsUpdate->seq_data);
     for (auto &ConversionPath : conversion_paths) {
+      // The packet is owned by the queue as soon as it is enqueued, so account
+      // for it in transit beforehand. A packet which fails to enqueue is
+      // destroyed here and releases its transit count again.
       auto ConversionPacket = ::make_unique<ConversionWorkPacket>();
-      cwp_last[ConversionPathID] = ConversionPacket.get();
       ConversionPacket->cp = ConversionPath.get();
       ConversionPacket->up = EpicsUpdate;
-      bool QueuedUnsuccessful = q2.enqueue(std::move(ConversionPacket));
-      if (QueuedUnsuccessful) {
-        CLOG(6, 1, "Conversion work queue is full");
+      ConversionPacket->stream = this;
+      ConversionPath->transit++;
+      if (!q2.enqueue(std::move(ConversionPacket))) {
+        LOG_LIMITED(6, "Conversion work queue is full");
+        Statistics->UpdatesDropped += ConversionPathSize - ConversionPathID;
+        QueueFull = true;
         break;
       }
       ConversionPathID += 1;
       n1 += 1;
     }
   }
-  if (n1 > 0) {
-    for (uint32_t i1 = 0; i1 < cwp_last.size(); ++i1) {
-      cwp_last[i1]->stream = this;
-      conversion_paths[i1]->transit++;
-    }
-  }
   return n1;
 }
 
@@ -126,7 +265,36 @@ int Stream::stop() {
   return 0;
 }
 
-int Stream::status() { return epics_client->status(); }
+void Stream::release_client() {
+  // The periodic updates may use the client concurrently.
+  std::atomic_store(&epics_client,
+                    std::shared_ptr<EpicsClient::EpicsClientInterface>());
+}
+
+void Stream::emit_cached_value() {
+  if (auto Client = std::atomic_load(&epics_client)) {
+    Client->emitCachedValue();
+  }
+}
+
+int Stream::status() {
+  if (epics_client == nullptr) {
+    return 0;
+  }
+  return epics_client->status();
+}
+
+bool Stream::connected() {
+  return epics_client != nullptr && epics_client->connected();
+}
+
+uint32_t Stream::in_flight() const {
+  uint32_t InFlight = 0;
+  for (auto const &Path : conversion_paths) {
+    InFlight += Path->transit.load();
+  }
+  return InFlight;
+}
 
 ChannelInfo const &Stream::channel_info() const { return channel_info_; }
 
@@ -138,19 +306,29 @@ nlohmann::json Stream::status_json() {
   auto const &ChannelInfo = channel_info();
   Document["channel_name"] = ChannelInfo.channel_name;
   Document["emit_queue_size"] = emit_queue_size();
-  {
-    std::unique_lock<std::mutex> lock(seq_data_emitted.mx);
-    auto const &Set = seq_data_emitted.set;
-    auto Last = Set.rbegin();
-    if (Last != Set.rend()) {
-      Document["emitted_max"] = Last->b;
-    }
+  uint64_t EmittedMax = 0;
+  if (seq_data_emitted.max(EmittedMax)) {
+    Document["emitted_max"] = EmittedMax;
   }
   auto Converters = json::array();
   for (auto const &Converter : conversion_paths) {
     Converters.push_back(Converter->status_json());
   }
   Document["converters"] = Converters;
+  Document["statistics"] = Statistics->to_json();
+  Document["loss"] = {{"ingest_missing", IngestLoss.missing()},
+                      {"ingest_repeated", IngestLoss.repeated()},
+                      {"ingest_restarts", IngestLoss.restarts()},
+                      {"produce_failed", Statistics->ProduceFailed.load()},
+                      {"delivery_failed", Statistics->DeliveryFailed.load()}};
   return Document;
 }
+
+StreamStatistics &Stream::statistics() { return *Statistics; }
+
+StreamSettings const &Stream::settings() const { return Settings; }
+
+void Stream::set_settings(StreamSettings Settings) {
+  this->Settings = std::move(Settings);
+}
 }
@@ -1,13 +1,17 @@
 #pragma once
 
+#include "ConfigParser.h"
 #include "ConversionWorker.h"
+#include "FlatbufferMessage.h"
 #include "Kafka.h"
 #include "RangeSet.h"
 #include "SchemaRegistry.h"
+#include "SequenceLossDetector.h"
 #include "uri.h"
 #include <EpicsClient/EpicsClientInterface.h>
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <concurrentqueue/concurrentqueue.h>
 #include <memory>
 #include <nlohmann/json.hpp>
@@ -23,6 +27,43 @@ struct ConversionWorkPacket;
 struct ChannelInfo {
   std::string provider_type;
   std::string channel_name;
+  MonitorSettings Monitor;
+};
+
+/**
+Lock-free traffic counters of a single Stream.
+
+The counters are incremented from the conversion workers without locking.
+Converted, produced and dropped are counted per conversion path, so an update
+which goes through two converters is counted twice.
+The rates are exponentially weighted moving averages which are only updated
+periodically from the main loop via updateRates().
+*/
+struct StreamStatistics : public FlatBufs::DeliveryObserver {
+  std::atomic<uint64_t> UpdatesReceived{0};
+  std::atomic<uint64_t> UpdatesConverted{0};
+  std::atomic<uint64_t> UpdatesProduced{0};
+  std::atomic<uint64_t> UpdatesDropped{0};
+  std::atomic<uint64_t> BytesProduced{0};
+  /// Repeated updates which were produced without converting them again.
+  std::atomic<uint64_t> UpdatesRepeated{0};
+  /// Updates which Kafka refused to accept into its queue.
+  std::atomic<uint64_t> ProduceFailed{0};
+  /// Outcome of the asynchronous delivery of produced updates.
+  std::atomic<uint64_t> Delivered{0};
+  std::atomic<uint64_t> DeliveryFailed{0};
+  std::atomic<double> UpdatesPerSecond{0};
+  std::atomic<double> BytesPerSecond{0};
+  void updateRates(std::chrono::steady_clock::time_point Now);
+  nlohmann::json to_json() const;
+  void deliveryOk() override;
+  void deliveryFailed() override;
+
+private:
+  bool HaveRateBaseline = false;
+  std::chrono::steady_clock::time_point LastRateUpdate;
+  uint64_t LastUpdatesProduced = 0;
+  uint64_t LastBytesProduced = 0;
 };
 
 /**
@@ -31,15 +72,32 @@ A combination of a converter and a kafka output destination.
 class ConversionPath {
 public:
   ConversionPath(ConversionPath &&x);
-  ConversionPath(std::shared_ptr<Converter>, std::unique_ptr<KafkaOutput>);
+  ConversionPath(std::shared_ptr<Converter>, std::unique_ptr<KafkaOutput>,
+                 std::shared_ptr<StreamStatistics> Statistics);
   ~ConversionPath();
   int emit(std::shared_ptr<FlatBufs::EpicsPVUpdate> up);
   std::atomic<uint32_t> transit{0};
   nlohmann::json status_json() const;
 
 private:
+  /// The serialized result of the last repeated update.
+  struct RepeatCache {
+    std::weak_ptr<FlatBufs::EpicsPVUpdate> Update;
+    std::shared_ptr<std::vector<uint8_t> const> Message;
+  };
+  FlatBufs::FlatbufferMessage::uptr
+  convert(std::shared_ptr<FlatBufs::EpicsPVUpdate> const &Update);
+  /// Converts with a builder sized from the recent message sizes.
+  FlatBufs::FlatbufferMessage::uptr
+  convertSized(FlatBufs::EpicsPVUpdate const &Update);
   std::shared_ptr<Converter> converter;
   std::unique_ptr<KafkaOutput> kafka_output;
+  std::shared_ptr<StreamStatistics> Statistics;
+  /// Only accessed through std::atomic_load and std::atomic_store, because
+  /// the conversion workers emit concurrently.
+  std::shared_ptr<RepeatCache const> LastRepeat;
+  /// Moving average of the size of the converted messages in bytes.
+  std::atomic<uint32_t> MessageSize{0};
 };
 
 /**
@@ -53,6 +111,9 @@ public:
       std::shared_ptr<
           moodycamel::ConcurrentQueue<std::shared_ptr<FlatBufs::EpicsPVUpdate>>>
           ring);
+  /// Continues the stream Previous with other converters. The EPICS client
+  /// and its queue are taken over, so the channel stays connected.
+  explicit Stream(Stream &Previous);
   Stream(Stream &&) = delete;
   ~Stream();
   int converter_add(InstanceSet &kset, std::shared_ptr<Converter> conv,
@@ -61,22 +122,43 @@ public:
       moodycamel::ConcurrentQueue<std::unique_ptr<ConversionWorkPacket>> &queue,
       uint32_t max, std::function<void(uint64_t)> on_seq_data);
   int stop();
+  /// Stops using the EPICS client without stopping it, because another
+  /// stream took it over.
+  void release_client();
+  /// Emits the last update of the EPICS client again.
+  void emit_cached_value();
   void error_in_epics();
   int status();
+  bool connected();
+  /// Number of conversion work packets queued or being converted.
+  uint32_t in_flight() const;
   ChannelInfo const &channel_info() const;
   size_t emit_queue_size();
   nlohmann::json status_json();
+  StreamStatistics &statistics();
+  /// The configuration this stream was created from.
+  StreamSettings const &settings() const;
+  void set_settings(StreamSettings Settings);
   using mutex = std::mutex;
   using ulock = std::unique_lock<mutex>;
 
 private:
   /// Each Epics update is converted by each Converter in the list
   ChannelInfo channel_info_;
+  StreamSettings Settings;
   std::vector<std::unique_ptr<ConversionPath>> conversion_paths;
   std::shared_ptr<EpicsClient::EpicsClientInterface> epics_client;
   std::shared_ptr<
       moodycamel::ConcurrentQueue<std::shared_ptr<FlatBufs::EpicsPVUpdate>>>
       emit_queue;
   RangeSet<uint64_t> seq_data_emitted;
+  std::shared_ptr<StreamStatistics> Statistics;
+  /// Detects updates lost before they reached the emit queue.
+  SequenceLossDetector IngestLoss;
+  /// The update which was last passed to IngestLoss. Repeated updates are
+  /// the cached update of the client emitted again, so they are accounted
+  /// only if their original was not seen yet, which can happen when the
+  /// update is marked as repeated before the original is dequeued.
+  std::shared_ptr<FlatBufs::EpicsPVUpdate> LastAccounted;
 };
 }
@@ -1,27 +1,97 @@
 #include "Streams.h"
 #include "Stream.h"
+#include "logger.h"
+#include <algorithm>
+#include <thread>
 
 namespace Forwarder {
+
+std::chrono::milliseconds const Streams::RetireGracePeriod{1000};
+
+/**
+ * Gets the number of active streams.
+ *
+ * @return The number of streams.
+ */
+size_t Streams::size() {
+  std::unique_lock<std::mutex> lock(streams_mutex);
+  return StreamsByID.size();
+}
+
+/**
+ * Marks the snapshot as outdated. Must be called with the streams_mutex held.
+ */
+void Streams::invalidateSnapshot() { SnapshotValid = false; }
+
+/**
+ * Builds and publishes a new snapshot. Must be called with the streams_mutex
+ * held.
+ *
+ * @return The new snapshot.
+ */
+Streams::StreamsSnapshot Streams::rebuildSnapshot() {
+  auto NewSnapshot = std::make_shared<std::vector<std::shared_ptr<Stream>>>();
+  NewSnapshot->reserve(StreamsByID.size());
+  for (auto const &Entry : StreamsByID) {
+    NewSnapshot->push_back(Entry.second);
+  }
+  std::atomic_store(&Snapshot, NewSnapshot);
+  SnapshotValid = true;
+  return NewSnapshot;
+}
+
 /**
- * Gets the number of streams in the streams vector.
+ * Get the current streams in the order they were added. The returned
+ * snapshot is not affected by later changes.
  *
- * @return The size of the stream vector.
+ * @return The snapshot of the streams.
  */
-size_t Streams::size() { return streams.size(); }
+Streams::StreamsSnapshot Streams::snapshot() {
+  if (SnapshotValid.load()) {
+    return std::atomic_load(&Snapshot);
+  }
+  std::unique_lock<std::mutex> lock(streams_mutex);
+  if (SnapshotValid.load()) {
+    return std::atomic_load(&Snapshot);
+  }
+  return rebuildSnapshot();
+}
+
+/**
+ * Stops the stream and keeps it until it can be destroyed safely.
+ * Must be called with the streams_mutex held.
+ *
+ * @param ID The ID of the stream to retire.
+ * @param Now The current time.
+ */
+void Streams::retire(uint64_t ID, std::chrono::steady_clock::time_point Now) {
+  auto It = StreamsByID.find(ID);
+  if (It == StreamsByID.end()) {
+    return;
+  }
+  It->second->stop();
+  RetiredStreams.push_back({std::move(It->second), Now});
+  StreamsByID.erase(It);
+  invalidateSnapshot();
+}
 
 /**
  * Stops specified channel and removes the stream.
  *
  * @param channel The name of the channel to stop.
+ * @return The number of streams which were removed.
  */
-void Streams::channel_stop(std::string const &channel) {
+size_t Streams::channel_stop(std::string const &channel) {
   std::unique_lock<std::mutex> lock(streams_mutex);
-  streams.erase(std::remove_if(streams.begin(), streams.end(),
-                               [&](std::shared_ptr<Stream> s) {
-                                 return (s->channel_info().channel_name ==
-                                         channel);
-                               }),
-                streams.end());
+  auto Now = std::chrono::steady_clock::now();
+  auto Range = IDsByChannel.equal_range(channel);
+  size_t Removed = 0;
+  for (auto It = Range.first; It != Range.second; ++It) {
+    retire(It->second, Now);
+    ++Removed;
+  }
+  IDsByChannel.erase(Range.first, Range.second);
+  return Removed;
 }
 
 /**
@@ -30,14 +100,14 @@ void Streams::channel_stop(std::string const &channel) {
 void Streams::streams_clear() {
   CLOG(7, 1, "Main::streams_clear()  begin");
   std::unique_lock<std::mutex> lock(streams_mutex);
-  if (!streams.empty()) {
-    for (auto x : streams) {
-      x->stop();
-    }
-    // Wait for Epics to cool down
-    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
-    streams.clear();
+  auto Now = std::chrono::steady_clock::now();
+  for (auto &Entry : StreamsByID) {
+    Entry.second->stop();
+    RetiredStreams.push_back({std::move(Entry.second), Now});
   }
+  StreamsByID.clear();
+  IDsByChannel.clear();
+  invalidateSnapshot();
   CLOG(7, 1, "Main::streams_clear()  end");
 };
 
@@ -45,37 +115,221 @@ void Streams::streams_clear() {
  * Check the status of the streams and stop any that are in error.
  */
 void Streams::check_stream_status() {
-  if (streams.empty()) {
-    return;
+  std::unique_lock<std::mutex> lock(streams_mutex);
+  auto Now = std::chrono::steady_clock::now();
+  for (auto It = IDsByChannel.begin(); It != IDsByChannel.end();) {
+    auto Stream = StreamsByID.find(It->second);
+    if (Stream != StreamsByID.end() && Stream->second->status() < 0) {
+      retire(It->second, Now);
+      It = IDsByChannel.erase(It);
+    } else {
+      ++It;
+    }
   }
-  streams.erase(std::remove_if(streams.begin(), streams.end(),
-                               [&](std::shared_ptr<Stream> s) {
-                                 if (s->status() < 0) {
-                                   s->stop();
-                                   return true;
-                                 }
-                                 return false;
-                               }),
-                streams.end());
 }
 
 /**
  * Add a stream.
  *
  * @param s the stream to add.
+ * @return The ID of the new stream.
  */
-void Streams::add(std::shared_ptr<Stream> s) { streams.push_back(s); }
+uint64_t Streams::add(std::shared_ptr<Stream> s) {
+  std::unique_lock<std::mutex> lock(streams_mutex);
+  auto ID = NextID++;
+  IDsByChannel.emplace(s->channel_info().channel_name, ID);
+  StreamsByID.emplace(ID, std::move(s));
+  invalidateSnapshot();
+  return ID;
+}
 
 /**
- * Get the last stream in the vector.
+ * Add many streams at once.
  *
- * @return The last stream in the vector.
+ * @param NewStreams The streams to add.
+ */
+void Streams::add(std::vector<std::shared_ptr<Stream>> const &NewStreams) {
+  std::unique_lock<std::mutex> lock(streams_mutex);
+  for (auto const &s : NewStreams) {
+    auto ID = NextID++;
+    IDsByChannel.emplace(s->channel_info().channel_name, ID);
+    StreamsByID.emplace_hint(StreamsByID.end(), ID, s);
+  }
+  invalidateSnapshot();
+}
+
+/**
+ * Replace a stream by one which took over its EPICS client. The new stream
+ * keeps the ID and therefore the position of the old one. The old stream is
+ * retired without stopping the client.
+ *
+ * @param Old The stream to replace.
+ * @param New The stream which continues the old one.
+ * @return False if the old stream is not active anymore.
+ */
+bool Streams::replace(std::shared_ptr<Stream> const &Old,
+                      std::shared_ptr<Stream> New) {
+  std::unique_lock<std::mutex> lock(streams_mutex);
+  auto Range = IDsByChannel.equal_range(Old->channel_info().channel_name);
+  for (auto It = Range.first; It != Range.second; ++It) {
+    auto &Current = StreamsByID.at(It->second);
+    if (Current == Old) {
+      Old->release_client();
+      RetiredStreams.push_back({Old, std::chrono::steady_clock::now()});
+      Current = std::move(New);
+      invalidateSnapshot();
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Get the most recently added stream.
+ *
+ * @return The last stream, or nullptr if there are none.
  */
 std::shared_ptr<Stream> Streams::back() {
-  return streams.empty() ? nullptr : streams.back();
+  std::unique_lock<std::mutex> lock(streams_mutex);
+  return StreamsByID.empty() ? nullptr : StreamsByID.rbegin()->second;
 }
 
-const std::vector<std::shared_ptr<Stream>> &Streams::get_streams() {
-  return streams;
+/**
+ * Find a stream by its ID.
+ *
+ * @param ID The ID returned by add().
+ * @return The stream, or nullptr if it is not active.
+ */
+std::shared_ptr<Stream> Streams::find(uint64_t ID) {
+  std::unique_lock<std::mutex> lock(streams_mutex);
+  auto It = StreamsByID.find(ID);
+  return It == StreamsByID.end() ? nullptr : It->second;
+}
+
+/**
+ * Find the streams of a channel.
+ *
+ * @param channel The channel name.
+ * @return The streams forwarding this channel.
+ */
+std::vector<std::shared_ptr<Stream>>
+Streams::find(std::string const &channel) {
+  std::unique_lock<std::mutex> lock(streams_mutex);
+  std::vector<std::shared_ptr<Stream>> Found;
+  auto Range = IDsByChannel.equal_range(channel);
+  for (auto It = Range.first; It != Range.second; ++It) {
+    Found.push_back(StreamsByID.at(It->second));
+  }
+  return Found;
+}
+
+/**
+ * Update the moving average rates of all streams.
+ *
+ * @param Now The current time.
+ */
+void Streams::update_rates(std::chrono::steady_clock::time_point Now) {
+  for (auto const &Stream : *snapshot()) {
+    Stream->statistics().updateRates(Now);
+  }
+}
+
+/**
+ * Get the streams with the highest produced byte rate.
+ *
+ * @param N The maximum number of streams to return.
+ * @return The streams ordered by descending byte rate.
+ */
+std::vector<std::shared_ptr<Stream>> Streams::hottest(size_t N) {
+  std::vector<std::shared_ptr<Stream>> Hottest(*snapshot());
+  auto ByteRateGreater = [](std::shared_ptr<Stream> const &A,
+                            std::shared_ptr<Stream> const &B) {
+    return A->statistics().BytesPerSecond.load() >
+           B->statistics().BytesPerSecond.load();
+  };
+  N = std::min(N, Hottest.size());
+  std::partial_sort(Hottest.begin(), Hottest.begin() + N, Hottest.end(),
+                    ByteRateGreater);
+  Hottest.resize(N);
+  return Hottest;
+}
+
+/**
+ * Get the number of streams whose EPICS channel is connected.
+ *
+ * @return The number of connected streams.
+ */
+size_t Streams::connected_count() {
+  auto Current = snapshot();
+  return std::count_if(
+      Current->begin(), Current->end(),
+      [](std::shared_ptr<Stream> const &s) { return s->connected(); });
+}
+
+/**
+ * Destroy the retired streams which are no longer referenced by a snapshot,
+ * have no work in flight and whose grace period has passed.
+ *
+ * @param Now The current time.
+ * @return The number of streams which are still retired.
+ */
+size_t Streams::reclaim(std::chrono::steady_clock::time_point Now) {
+  std::vector<std::shared_ptr<Stream>> Reclaimed;
+  std::unique_lock<std::mutex> lock(streams_mutex);
+  if (RetiredStreams.empty()) {
+    return 0;
+  }
+  // Drop the reference from the outdated snapshot.
+  if (!SnapshotValid.load()) {
+    rebuildSnapshot();
+  }
+  RetiredStreams.erase(
+      std::remove_if(RetiredStreams.begin(), RetiredStreams.end(),
+                     [&](RetiredStream &Retired) {
+                       if (Now - Retired.RetiredAt < RetireGracePeriod ||
+                           Retired.stream.use_count() > 1 ||
+                           Retired.stream->in_flight() > 0) {
+                         return false;
+                       }
+                       Reclaimed.push_back(std::move(Retired.stream));
+                       return true;
+                     }),
+      RetiredStreams.end());
+  auto Remaining = RetiredStreams.size();
+  lock.unlock();
+  // The streams are destroyed here, outside of the lock.
+  Reclaimed.clear();
+  return Remaining;
+}
+
+/**
+ * Get the number of retired streams which are not yet destroyed.
+ *
+ * @return The number of retired streams.
+ */
+size_t Streams::retired_count() {
+  std::unique_lock<std::mutex> lock(streams_mutex);
+  return RetiredStreams.size();
+}
+
+/**
+ * Wait until all retired streams are destroyed. Used at shutdown.
+ *
+ * @param Timeout Give up waiting after this time.
+ */
+void Streams::drain_retired(std::chrono::milliseconds Timeout) {
+  auto Start = std::chrono::steady_clock::now();
+  while (true) {
+    auto Now = std::chrono::steady_clock::now();
+    if (reclaim(Now) == 0) {
+      return;
+    }
+    if (Now - Start > Timeout) {
+      LOG(4, "{} retired streams still have work in flight",
+          retired_count());
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+}
 }
-}
\ No newline at end of file
@@ -1,29 +1,74 @@
 #ifndef FORWARD_EPICS_TO_KAFKA_STREAMS_H
 #define FORWARD_EPICS_TO_KAFKA_STREAMS_H
 #include "Stream.h"
+#include <atomic>
+#include <chrono>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace Forwarder {
 
 class Stream;
 
+/// \brief
+/// Registry of the active streams.
+///
+/// Each stream gets a stable ID in the order it was added and is indexed by
+/// its channel name. Readers like the conversion scheduler use an immutable
+/// snapshot of the current streams. The snapshot is only rebuilt on the first
+/// read after a change, so reading never waits for commands and a batch of
+/// changes costs one rebuild.
+///
+/// Removed streams are stopped and retired instead of destroyed right away.
+/// Conversion workers may still hold work for a retired stream, and EPICS may
+/// still deliver callbacks for a short while after the channel was stopped.
+/// A retired stream is destroyed by reclaim() once no snapshot refers to it,
+/// it has no work in flight and the grace period has passed.
 class Streams {
-private:
-  std::vector<std::shared_ptr<Stream>> streams;
-  std::mutex streams_mutex;
-
 public:
+  using StreamsSnapshot = std::shared_ptr<std::vector<std::shared_ptr<Stream>>>;
+  /// Time to keep a retired stream after it was stopped.
+  static std::chrono::milliseconds const RetireGracePeriod;
   size_t size();
-  void channel_stop(std::string const &channel);
+  size_t channel_stop(std::string const &channel);
   void streams_clear();
   void check_stream_status();
-  void add(std::shared_ptr<Stream> s);
+  uint64_t add(std::shared_ptr<Stream> s);
+  void add(std::vector<std::shared_ptr<Stream>> const &NewStreams);
+  bool replace(std::shared_ptr<Stream> const &Old,
+               std::shared_ptr<Stream> New);
   std::shared_ptr<Stream> back();
-  std::shared_ptr<Stream> operator[](size_t s) { return streams.at(s); };
-  const std::vector<std::shared_ptr<Stream>> &get_streams();
+  std::shared_ptr<Stream> operator[](size_t s) { return snapshot()->at(s); };
+  std::shared_ptr<Stream> find(uint64_t ID);
+  std::vector<std::shared_ptr<Stream>> find(std::string const &channel);
+  StreamsSnapshot snapshot();
+  void update_rates(std::chrono::steady_clock::time_point Now);
+  std::vector<std::shared_ptr<Stream>> hottest(size_t N);
+  size_t connected_count();
+  size_t reclaim(std::chrono::steady_clock::time_point Now);
+  size_t retired_count();
+  void drain_retired(std::chrono::milliseconds Timeout);
+
+private:
+  struct RetiredStream {
+    std::shared_ptr<Stream> stream;
+    std::chrono::steady_clock::time_point RetiredAt;
+  };
+  void retire(uint64_t ID, std::chrono::steady_clock::time_point Now);
+  void invalidateSnapshot();
+  StreamsSnapshot rebuildSnapshot();
+  std::map<uint64_t, std::shared_ptr<Stream>> StreamsByID;
+  std::unordered_multimap<std::string, uint64_t> IDsByChannel;
+  uint64_t NextID = 0;
+  std::vector<RetiredStream> RetiredStreams;
+  /// Only accessed through std::atomic_load and std::atomic_store.
+  StreamsSnapshot Snapshot;
+  std::atomic<bool> SnapshotValid{false};
+  std::mutex streams_mutex;
 };
 }
 #endif // FORWARD_EPICS_TO_KAFKA_STREAMS_H
@@ -0,0 +1,87 @@
+#include "TimingWheel.h"
+#include <algorithm>
+
+namespace Forwarder {
+
+TimingWheel::TimingWheel(std::chrono::milliseconds Resolution,
+                         size_t SlotCount, Clock::time_point Start)
+    : Resolution(std::max(Resolution, std::chrono::milliseconds(1))),
+      Start(Start), Slots(std::max<size_t>(SlotCount, 1)) {}
+
+void TimingWheel::add(std::chrono::milliseconds Period, Callback Function) {
+  auto Timer = std::make_shared<Entry>();
+  Timer->Function = std::move(Function);
+  Timer->PeriodTicks = std::max<uint64_t>(1, Period / Resolution);
+  std::lock_guard<std::mutex> Lock(Mutex);
+  std::uniform_int_distribution<uint64_t> Phase(0, Timer->PeriodTicks - 1);
+  Timer->DeadlineTick = CurrentTick + 1 + Phase(Random);
+  insert(Timer);
+  ++Count;
+}
+
+void TimingWheel::insert(std::shared_ptr<Entry> const &Timer) {
+  Slots[Timer->DeadlineTick % Slots.size()].push_back(Timer);
+}
+
+size_t TimingWheel::advance(Clock::time_point Now) {
+  std::unique_lock<std::mutex> Lock(Mutex, std::try_to_lock);
+  if (!Lock.owns_lock() || Now < Start) {
+    return 0;
+  }
+  uint64_t TargetTick = (Now - Start) / Resolution;
+  size_t Queued = 0;
+  std::vector<std::shared_ptr<Entry>> Slot;
+  while (CurrentTick < TargetTick) {
+    ++CurrentTick;
+    Slot.clear();
+    Slot.swap(Slots[CurrentTick % Slots.size()]);
+    for (auto &Timer : Slot) {
+      if (Timer->Cancelled) {
+        --Count;
+        continue;
+      }
+      if (Timer->DeadlineTick > CurrentTick) {
+        // Due in a later round of the wheel.
+        insert(Timer);
+        continue;
+      }
+      if (Timer->Queued.exchange(true)) {
+        ++Overruns;
+      } else {
+        Ready.enqueue(Timer);
+        ++Queued;
+      }
+      Timer->DeadlineTick += Timer->PeriodTicks;
+      if (Timer->DeadlineTick <= TargetTick) {
+        // Queue at most once per sweep. Keep the phase but skip the periods
+        // which were missed.
+        auto Behind = TargetTick - Timer->DeadlineTick;
+        Timer->DeadlineTick +=
+            (Behind / Timer->PeriodTicks + 1) * Timer->PeriodTicks;
+      }
+      insert(Timer);
+    }
+  }
+  return Queued;
+}
+
+size_t TimingWheel::runDue(size_t Max) {
+  size_t Run = 0;
+  std::shared_ptr<Entry> Timer;
+  while (Run < Max && Ready.try_dequeue(Timer)) {
+    if (!Timer->Cancelled && !Timer->Function()) {
+      Timer->Cancelled = true;
+    }
+    Timer->Queued = false;
+    ++Run;
+  }
+  return Run;
+}
+
+size_t TimingWheel::size() const {
+  std::lock_guard<std::mutex> Lock(Mutex);
+  return Count;
+}
+
+uint64_t TimingWheel::overruns() const { return Overruns.load(); }
+}
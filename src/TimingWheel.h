@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <concurrentqueue/concurrentqueue.h>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <vector>
+
+namespace Forwarder {
+
+/// \brief
+/// Hashed timing wheel for periodic callbacks with individual periods.
+///
+/// Time advances in ticks of the given resolution and each tick has a slot
+/// on the wheel. A callback sits in the slot of its next deadline, so a sweep
+/// only looks at the slots which passed since the last sweep instead of at
+/// all callbacks. Callbacks which are added get a random phase within their
+/// period, so that many callbacks with the same period do not all become due
+/// in the same tick.
+///
+/// Sweeping and running the callbacks are separate: advance() moves the due
+/// callbacks to a queue from which any number of threads can run them via
+/// runDue(). A callback which is still queued when it becomes due again is
+/// skipped and counted as an overrun.
+class TimingWheel {
+public:
+  using Clock = std::chrono::steady_clock;
+  /// Returns false when the callback should not be called anymore.
+  using Callback = std::function<bool()>;
+
+  TimingWheel(std::chrono::milliseconds Resolution, size_t SlotCount,
+              Clock::time_point Start = Clock::now());
+
+  /// Adds a periodic callback.
+  void add(std::chrono::milliseconds Period, Callback Function);
+
+  /// Queues the callbacks which became due up to the given time. Returns
+  /// immediately if another thread is sweeping already.
+  ///
+  /// \return The number of callbacks which were queued.
+  size_t advance(Clock::time_point Now);
+
+  /// Runs up to Max of the queued callbacks.
+  ///
+  /// \return The number of callbacks which were run.
+  size_t runDue(size_t Max);
+
+  /// The number of registered callbacks.
+  size_t size() const;
+
+  /// The number of times a callback was due while its last run was pending.
+  uint64_t overruns() const;
+
+private:
+  struct Entry {
+    Callback Function;
+    uint64_t PeriodTicks;
+    uint64_t DeadlineTick;
+    std::atomic<bool> Queued{false};
+    std::atomic<bool> Cancelled{false};
+  };
+  void insert(std::shared_ptr<Entry> const &Timer);
+  std::chrono::milliseconds Resolution;
+  Clock::time_point Start;
+  std::vector<std::vector<std::shared_ptr<Entry>>> Slots;
+  /// The last tick which was swept.
+  uint64_t CurrentTick = 0;
+  std::minstd_rand Random;
+  mutable std::mutex Mutex;
+  size_t Count = 0;
+  moodycamel::ConcurrentQueue<std::shared_ptr<Entry>> Ready;
+  std::atomic<uint64_t> Overruns{0};
+};
+}
@@ -1,5 +1,6 @@
 #include "logger.h"
 #include "KafkaW/KafkaW.h"
+#include "LoggerImpl.h"
 #include <atomic>
 #include <cstdarg>
 #include <cstdio>
@@ -13,10 +14,13 @@
 #include <unistd.h>
 #endif
 #include <atomic>
+#include <concurrentqueue/concurrentqueue.h>
 #include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
 #include <string>
 #include <thread>
+#include <vector>
 #ifdef HAVE_GRAYLOG_LOGGER
 #include <graylog_logger/GraylogInterface.hpp>
 #include <graylog_logger/Log.hpp>
@@ -24,36 +28,16 @@
 
 int log_level = 3;
 
-// adhoc namespace because it would now collide with ::Logger defined
-// in gralog_logger
-
 namespace DW {
 
-class Logger {
-public:
-  Logger();
-  ~Logger();
-  void use_log_file(std::string fname);
-  void log_kafka_gelf_start(std::string broker, std::string topic);
-  void log_kafka_gelf_stop();
-  FILE *log_file = stdout;
-  int is_tty = 1;
-  void dwlog_inner(int level, int color, char const *file, int line,
-                   char const *func, std::string const &s1);
-  int prefix_len();
-  void fwd_graylog_logger_enable(std::string address);
-
-private:
-  std::atomic<bool> do_run_kafka{false};
-  std::atomic<bool> do_use_graylog_logger{false};
-  std::shared_ptr<KafkaW::Producer> producer;
-  std::unique_ptr<KafkaW::Producer::Topic> topic;
-  std::thread thread_poll;
-};
-
-Logger::Logger() { is_tty = isatty(fileno(log_file)); }
+Logger::Logger() {
+  is_tty = isatty(fileno(log_file));
+  WriterRunning = true;
+  WriterThread = std::thread([this] { runWriter(); });
+}
 
 Logger::~Logger() {
+  stopWriter();
   do_run_kafka = false;
   if (log_file != nullptr and log_file != stdout) {
     LOG(0, "Closing log");
@@ -64,8 +48,20 @@ Logger::~Logger() {
   }
 }
 
+void Logger::stopWriter() {
+  WriterRunning = false;
+  // Pairs with the fence in dwlog_inner(), so that a message which is
+  // enqueued concurrently is either drained here or by its thread.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (WriterThread.joinable()) {
+    WriterThread.join();
+  }
+  drain();
+}
+
 void Logger::use_log_file(std::string fname) {
   FILE *f1 = fopen(fname.c_str(), "wb");
+  std::unique_lock<std::mutex> lock(WriteMutex);
   log_file = f1;
   is_tty = isatty(fileno(log_file));
 }
@@ -107,38 +103,100 @@ void Logger::fwd_graylog_logger_enable(std::string address) {
 
 void Logger::dwlog_inner(int level, int color, char const *file, int line,
                          char const *func, std::string const &s1) {
+  if (level <= 3 || !WriterRunning.load()) {
+    std::unique_lock<std::mutex> lock(WriteMutex);
+    // Queued messages go first, so that the messages stay in order.
+    drainLocked();
+    write(LogRecord{level, color, file, line, s1});
+    fflush(log_file);
+    return;
+  }
+  if (Queued.load() >= MaxQueuedRecords) {
+    ++Dropped;
+    return;
+  }
+  ++Queued;
+  Queue.enqueue(LogRecord{level, color, file, line, s1});
+  // If the writer was stopped in the meantime, its last drain may have missed
+  // this message.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!WriterRunning.load()) {
+    drain();
+  }
+}
+
+void Logger::runWriter() {
+  while (WriterRunning.load()) {
+    if (drain() == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+  }
+}
+
+/// Write all queued messages, returns the number of messages written.
+size_t Logger::drain() {
+  std::unique_lock<std::mutex> lock(WriteMutex);
+  return drainLocked();
+}
+
+size_t Logger::drainLocked() {
+  std::vector<LogRecord> Records(256);
+  size_t Total = 0;
+  while (true) {
+    auto n = Queue.try_dequeue_bulk(Records.begin(), Records.size());
+    if (n == 0) {
+      break;
+    }
+    Queued -= n;
+    Total += n;
+    for (size_t i = 0; i < n; ++i) {
+      write(Records[i]);
+    }
+  }
+  if (auto n = Dropped.exchange(0)) {
+    write({4, 0, __FILE__, __LINE__,
+           fmt::format("Dropped {} log messages", n)});
+  }
+  if (Total > 0) {
+    fflush(log_file);
+  }
+  return Total;
+}
+
+void Logger::write(LogRecord const &Record) {
+  auto level = Record.level;
+  auto color = Record.color;
+  auto file = Record.file;
+  auto line = Record.line;
+  auto const &s1 = Record.message;
   int npre = prefix_len();
   int const n2 = strlen(file);
   if (npre > n2) {
     npre = 0;
   }
   auto f1 = file + npre;
-  {
-    // only use color for stdout
-    std::string lmsg;
-    if (is_tty && color > 0 && color < 8) {
-      static char const *cols[]{
-          "",
-          "\x1b[107;1;31m",
-          "\x1b[100;1;33m",
-          "\x1b[107;1;35m",
-          "\x1b[107;1;36m",
-          "\x1b[107;1;34m",
-          "\x1b[107;1;32m",
-          "\x1b[107;1;30m",
-      };
-      lmsg = fmt::format("{}:{} [{}]:  {}{}\x1b[0m\n", f1, line, level,
-                         cols[color], s1);
-    } else {
-      lmsg = fmt::format("{}:{} [{}]:  {}\n", f1, line, level, s1);
-    }
+  // Without color, the message for the log file and for Kafka or Graylog is
+  // the same and only formatted once.
+  auto lmsg = fmt::format("{}:{} [{}]:  {}\n", f1, line, level, s1);
+  // only use color for stdout
+  if (is_tty && color > 0 && color < 8) {
+    static char const *cols[]{
+        "",
+        "\x1b[107;1;31m",
+        "\x1b[100;1;33m",
+        "\x1b[107;1;35m",
+        "\x1b[107;1;36m",
+        "\x1b[107;1;34m",
+        "\x1b[107;1;32m",
+        "\x1b[107;1;30m",
+    };
+    auto cmsg = fmt::format("{}:{} [{}]:  {}{}\x1b[0m\n", f1, line, level,
+                            cols[color], s1);
+    fwrite(cmsg.c_str(), 1, cmsg.size(), log_file);
+  } else {
     fwrite(lmsg.c_str(), 1, lmsg.size(), log_file);
   }
   if (level < 7 && do_run_kafka.load()) {
-    // Format again without color
-    auto lmsg = fmt::format("{}:{} [{}]:  {}\n", f1, line, level, s1);
-    // If we will use logging to Kafka in the future, refactor a bit to reduce
-    // duplicate work..
     using nlohmann::json;
     auto Document = json::object();
     Document["version"] = "1.1";
@@ -152,8 +210,6 @@ void Logger::dwlog_inner(int level, int color, char const *file, int line,
   }
 #ifdef HAVE_GRAYLOG_LOGGER
   if (do_use_graylog_logger.load() and level < 7) {
-    // Format again without color
-    auto lmsg = fmt::format("{}:{} [{}]:  {}\n", f1, line, level, s1);
     Log::Msg(level, lmsg);
   }
 #endif
@@ -181,3 +237,41 @@ void log_kafka_gelf_start(std::string broker, std::string topic) {
 void fwd_graylog_logger_enable(std::string address) {
   DW::g__logger.fwd_graylog_logger_enable(address);
 }
+
+LogRateLimiter::LogRateLimiter(uint32_t MaxPerPeriod,
+                               std::chrono::milliseconds Period)
+    : MaxPerPeriod(MaxPerPeriod),
+      PeriodNS(std::chrono::duration_cast<std::chrono::nanoseconds>(Period)
+                   .count()) {}
+
+bool LogRateLimiter::allow(uint64_t &Suppressed) {
+  return allow(Suppressed, std::chrono::steady_clock::now());
+}
+
+bool LogRateLimiter::allow(uint64_t &Suppressed,
+                           std::chrono::steady_clock::time_point Now) {
+  int64_t NowNS = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      Now.time_since_epoch())
+                      .count();
+  auto Start = PeriodStart.load();
+  if (NowNS - Start >= PeriodNS &&
+      PeriodStart.compare_exchange_strong(Start, NowNS)) {
+    CountInPeriod = 0;
+  }
+  if (CountInPeriod.load() < MaxPerPeriod && CountInPeriod++ < MaxPerPeriod) {
+    Suppressed = SuppressedCount.exchange(0);
+    return true;
+  }
+  ++SuppressedCount;
+  Suppressed = 0;
+  return false;
+}
+
+void dwlog_suppressed(int level, uint64_t Suppressed, char const *file,
+                      int line, char const *func) {
+  if (Suppressed == 0) {
+    return;
+  }
+  dwlog_inner(level, 0, file, line, func,
+              fmt::format("Suppressed {} messages of this kind", Suppressed));
+}
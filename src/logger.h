@@ -3,23 +3,72 @@
 #include <fmt/format.h>
 #include <string>
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/// Log statements above this level are removed at compile time and their
+/// arguments are never evaluated. Release builds drop debug messages unless
+/// this is defined explicitly.
+#ifndef LOG_LEVEL_COMPILED
+#ifdef NDEBUG
+#define LOG_LEVEL_COMPILED 6
+#else
+#define LOG_LEVEL_COMPILED 9
+#endif
+#endif
+
+#define LOG_ENABLED(level)                                                     \
+  (static_cast<int>(level) <= LOG_LEVEL_COMPILED &&                            \
+   static_cast<int>(level) <= log_level)
+
 #ifdef _MSC_VER
 
 #define LOG(level, fmt, ...)                                                   \
-  dwlog(static_cast<int>(level), 0, fmt, __FILE__, __LINE__, __FUNCSIG__,      \
-        __VA_ARGS__);
-#define CLOG(level, c, fmt, ...)                                               \
-  dwlog(static_cast<int>(level), 0, fmt, __FILE__, __LINE__, __FUNCSIG__,      \
-        __VA_ARGS__);
+  do {                                                                         \
+    if (LOG_ENABLED(level)) {                                                  \
+      dwlog(static_cast<int>(level), 0, fmt, __FILE__, __LINE__, __FUNCSIG__,  \
+            __VA_ARGS__);                                                      \
+    }                                                                          \
+  } while (0);
+#define CLOG(level, c, fmt, ...) LOG(level, fmt, __VA_ARGS__)
+#define LOG_LIMITED(level, fmt, ...)                                           \
+  do {                                                                         \
+    if (LOG_ENABLED(level)) {                                                  \
+      static LogRateLimiter Limiter__;                                         \
+      uint64_t Suppressed__ = 0;                                               \
+      if (Limiter__.allow(Suppressed__)) {                                     \
+        dwlog_suppressed(static_cast<int>(level), Suppressed__, __FILE__,      \
+                         __LINE__, __FUNCSIG__);                               \
+        dwlog(static_cast<int>(level), 0, fmt, __FILE__, __LINE__,             \
+              __FUNCSIG__, __VA_ARGS__);                                       \
+      }                                                                        \
+    }                                                                          \
+  } while (0);
 
 #else
 
 #define LOG(level, fmt, args...)                                               \
-  dwlog(static_cast<int>(level), 0, fmt, __FILE__, __LINE__,                   \
-        __PRETTY_FUNCTION__, ##args);
-#define CLOG(level, c, fmt, args...)                                           \
-  dwlog(static_cast<int>(level), 0, fmt, __FILE__, __LINE__,                   \
-        __PRETTY_FUNCTION__, ##args);
+  do {                                                                         \
+    if (LOG_ENABLED(level)) {                                                  \
+      dwlog(static_cast<int>(level), 0, fmt, __FILE__, __LINE__,               \
+            __PRETTY_FUNCTION__, ##args);                                      \
+    }                                                                          \
+  } while (0);
+#define CLOG(level, c, fmt, args...) LOG(level, fmt, ##args)
+#define LOG_LIMITED(level, fmt, args...)                                       \
+  do {                                                                         \
+    if (LOG_ENABLED(level)) {                                                  \
+      static LogRateLimiter Limiter__;                                         \
+      uint64_t Suppressed__ = 0;                                               \
+      if (Limiter__.allow(Suppressed__)) {                                     \
+        dwlog_suppressed(static_cast<int>(level), Suppressed__, __FILE__,      \
+                         __LINE__, __PRETTY_FUNCTION__);                       \
+        dwlog(static_cast<int>(level), 0, fmt, __FILE__, __LINE__,             \
+              __PRETTY_FUNCTION__, ##args);                                    \
+      }                                                                        \
+    }                                                                          \
+  } while (0);
 
 #endif
 
@@ -55,6 +104,34 @@ void dwlog(int level, int c, char const *fmt, char const *file, int line,
   }
 }
 
+/// \brief
+/// Limits how often a single log statement is written.
+///
+/// Used by LOG_LIMITED, which keeps one limiter per call site. At most
+/// MaxPerPeriod messages pass per period, the rest are counted and the count
+/// is reported with the next message which passes.
+class LogRateLimiter {
+public:
+  explicit LogRateLimiter(
+      uint32_t MaxPerPeriod = 10,
+      std::chrono::milliseconds Period = std::chrono::milliseconds(1000));
+  /// Returns true if the message should be written. Suppressed is set to the
+  /// number of messages suppressed since the last one which passed.
+  bool allow(uint64_t &Suppressed);
+  bool allow(uint64_t &Suppressed, std::chrono::steady_clock::time_point Now);
+
+private:
+  uint32_t MaxPerPeriod;
+  int64_t PeriodNS;
+  std::atomic<int64_t> PeriodStart{0};
+  std::atomic<uint32_t> CountInPeriod{0};
+  std::atomic<uint64_t> SuppressedCount{0};
+};
+
+/// Logs the number of suppressed messages if non-zero.
+void dwlog_suppressed(int level, uint64_t Suppressed, char const *file,
+                      int line, char const *func);
+
 void use_log_file(std::string fname);
 
 void log_kafka_gelf_start(std::string broker, std::string topic);
@@ -1,4 +1,5 @@
 #include "../../EpicsPVUpdate.h"
+#include "../../FlatbufferStringVector.h"
 #include "../../RangeSet.h"
 #include "../../SchemaRegistry.h"
 #include "../../helper.h"
@@ -247,6 +248,20 @@ public:
   }
 };
 
+class MakeArrayString {
+public:
+  static Value_t convert(flatbuffers::FlatBufferBuilder *Builder,
+                         epics::pvData::PVScalarArray *PVScalarArray) {
+    auto PVStringArray =
+        static_cast<epics::pvData::PVValueArray<std::string> *>(PVScalarArray);
+    auto FlatbufferedStrings =
+        createStringVector(*Builder, PVStringArray->view());
+    ArrayStringBuilder ValueBuilder(*Builder);
+    ValueBuilder.add_value(FlatbufferedStrings);
+    return {Value::ArrayString, ValueBuilder.Finish().Union()};
+  }
+};
+
 } // end namespace PVStructureToFlatBufferN
 
 Value_t make_Value_scalar(flatbuffers::FlatBufferBuilder &builder,
@@ -318,8 +333,7 @@ Value_t make_Value_array(flatbuffers::FlatBufferBuilder &builder,
   case S::pvDouble:
     return Make_ScalarArray<double>::convert(&builder, field, opts);
   case S::pvString:
-    ++statistics.err_not_implemented_yet;
-    break;
+    return MakeArrayString::convert(&builder, field);
   }
   return {Value::NONE, 0};
 }
@@ -399,8 +413,13 @@ public:
   ~Converter() override { LOG(3, "~Converter"); }
 
   FlatBufs::FlatbufferMessage::uptr convert(EpicsPVUpdate const &up) override {
+    return convertWithSizeHint(up, 0);
+  }
+
+  FlatBufs::FlatbufferMessage::uptr
+  convertWithSizeHint(EpicsPVUpdate const &up, uint32_t InitialSize) override {
     auto &pvstr = up.epics_pvstr;
-    auto fb = make_unique<FlatBufs::FlatbufferMessage>();
+    auto fb = FlatBufs::FlatbufferMessage::create(InitialSize);
 
     auto builder = fb->builder.get();
     // this is the field type ID string: up.pvstr->getStructure()->getID()
@@ -1,135 +1,231 @@
 #include "../../EpicsPVUpdate.h"
+#include "../../FlatbufferStringVector.h"
 #include "../../SchemaRegistry.h"
 #include "../../helper.h"
 #include "../../logger.h"
 #include "schemas/f143_structure_generated.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace FlatBufs {
 namespace f143 {
 
-#include <fmt/format.h>
-
-#define DO_FLOG 1
-#if DO_FLOG
-using fmt::print;
-#ifdef _MSC_VER
-#define FLOG(level, fmt, ...)                                                  \
-  if (level < 60) {                                                            \
-    print("{:{}s}" fmt "\n", "", 2 * (level), __VA_ARGS__);                    \
-  }
-#else
-#define FLOG(level, fmt, args...)                                              \
-  if (level < 60) {                                                            \
-    print("{:{}s}" fmt "\n", "", 2 * (level), ##args);                         \
-  }
-#endif
-#else
-#define FLOG(level, fmt, ...)
-#endif
-
 namespace fbg {
 
+static_assert(sizeof(epics::pvData::boolean) == 1,
+              "Boolean arrays are copied as bytes");
+
 using std::vector;
 using std::string;
-using fmt::print;
 using namespace f143_structure;
+using epics::pvData::PVField;
 using epics::pvData::PVStructure;
+using epics::pvData::ScalarType;
+using epics::pvData::Type;
 typedef struct {
   Value type;
   flatbuffers::Offset<void> off;
 } V_t;
 
-V_t Field(flatbuffers::FlatBufferBuilder &builder,
-          epics::pvData::PVField const *field, int level);
+/// A field of a serialization plan.
+struct PlanNode {
+  Type FieldType;
+  /// Scalar type of a scalar or element type of a scalar array.
+  ScalarType ElementType;
+  string Name;
+  /// Index of the first node after the subtree of this node.
+  size_t Next;
+};
+
+/// \brief
+/// Serialization plan of an introspection interface.
+///
+/// The nodes are the fields in depth-first order, so the subfields of a
+/// structure directly follow it. A structure array has the plan of its
+/// element structure as its only subtree. The plan saves walking the
+/// introspection interface and copying the field names for every update.
+struct Plan {
+  /// Keeps the introspection interface, which is the key of the plan cache,
+  /// alive.
+  epics::pvData::FieldConstPtr Field;
+  vector<PlanNode> Nodes;
+};
+
+static void addPlanNodes(vector<PlanNode> &Nodes,
+                         epics::pvData::Field const *Field, string Name) {
+  auto Index = Nodes.size();
+  Nodes.push_back({Field->getType(), ScalarType::pvBoolean, std::move(Name),
+                   0});
+  switch (Field->getType()) {
+  case Type::structure: {
+    auto Structure = static_cast<epics::pvData::Structure const *>(Field);
+    auto &Subfields = Structure->getFields();
+    auto &Names = Structure->getFieldNames();
+    for (size_t i = 0; i < Subfields.size(); ++i) {
+      addPlanNodes(Nodes, Subfields[i].get(), Names[i]);
+    }
+    break;
+  }
+  case Type::structureArray:
+    addPlanNodes(
+        Nodes, static_cast<epics::pvData::StructureArray const *>(Field)
+                   ->getStructure()
+                   .get(),
+        "");
+    break;
+  case Type::scalar:
+    Nodes[Index].ElementType =
+        static_cast<epics::pvData::Scalar const *>(Field)->getScalarType();
+    break;
+  case Type::scalarArray:
+    Nodes[Index].ElementType =
+        static_cast<epics::pvData::ScalarArray const *>(Field)
+            ->getElementType();
+    break;
+  default:
+    break;
+  }
+  Nodes[Index].Next = Nodes.size();
+}
+
+/// Upper limit for the plans cached per thread.
+static size_t const MaxCachedPlans = 1024;
+
+/// Per thread state of the serializer. The stacks are reused for every
+/// update, so that the traversal does not allocate once they have grown.
+struct Scratch {
+  std::unordered_map<epics::pvData::Field const *, std::shared_ptr<Plan>>
+      Plans;
+  /// Values of the subfields of the structures being serialized, together
+  /// with their names.
+  vector<std::pair<V_t, string const *>> Members;
+  vector<flatbuffers::Offset<ObjM>> ObjMs;
+  vector<flatbuffers::Offset<Obj>> Objs;
+};
+
+static Scratch &scratch() {
+  static thread_local Scratch ThreadScratch;
+  return ThreadScratch;
+}
+
+/// Returns the cached plan of the introspection interface, or creates it.
+/// The introspection interface of a channel usually stays the same, so
+/// plans are rarely created.
+static std::shared_ptr<Plan>
+planFor(Scratch &Stacks, epics::pvData::FieldConstPtr const &Field) {
+  auto It = Stacks.Plans.find(Field.get());
+  if (It != Stacks.Plans.end()) {
+    return It->second;
+  }
+  if (Stacks.Plans.size() >= MaxCachedPlans) {
+    Stacks.Plans.clear();
+  }
+  auto NewPlan = std::make_shared<Plan>();
+  NewPlan->Field = Field;
+  addPlanNodes(NewPlan->Nodes, Field.get(), "");
+  Stacks.Plans[Field.get()] = NewPlan;
+  return NewPlan;
+}
 
-inline static V_t field_PVStructure(flatbuffers::FlatBufferBuilder &builder,
-                                    PVStructure const *field, int level) {
-  auto &subfields = field->getPVFields();
-  FLOG(level, "structure  subfields.size(): {}", subfields.size());
+struct Context {
+  flatbuffers::FlatBufferBuilder &Builder;
+  Scratch &Stacks;
+};
+
+V_t Field(Context &C, PVField const *Field, vector<PlanNode> const &Nodes,
+          size_t Index);
 
-  // For each subfield, collect the offsets:
-  vector<string> names;
-  vector<V_t> fs;
-  for (auto &f1ptr : subfields) {
-    names.push_back(f1ptr->getFieldName());
-    auto v1 = Field(builder, f1ptr.get(), 1 + level);
-    if (v1.type != Value::NONE) {
-      fs.push_back(v1);
+inline static V_t field_PVStructure(Context &C, PVStructure const *Field,
+                                    vector<PlanNode> const &Nodes,
+                                    size_t Index) {
+  auto &Builder = C.Builder;
+  auto &Members = C.Stacks.Members;
+  auto MembersBase = Members.size();
+  auto Child = Index + 1;
+  for (auto &Subfield : Field->getPVFields()) {
+    if (Child >= Nodes[Index].Next) {
+      break;
+    }
+    auto V = fbg::Field(C, Subfield.get(), Nodes, Child);
+    if (V.type != Value::NONE) {
+      Members.emplace_back(V, &Nodes[Child].Name);
     }
+    Child = Nodes[Child].Next;
   }
 
-  // With the collected offsets, create object members
-  // Collect raw vector of offsets to store later in flat buffer
-  vector<flatbuffers::Offset<ObjM>> f2;
-  uint32_t i1 = 0;
-  for (auto &x : fs) {
-    FLOG(level, "off: {:5d}  {}", x.off.o, names[i1]);
-    auto n1 = builder.CreateString(names[i1]);
-    ObjMBuilder b1(builder);
-    b1.add_k(n1);
-    b1.add_v_type(x.type);
-    b1.add_v(x.off);
-    f2.push_back(b1.Finish());
-    ++i1;
+  // With the collected offsets, create the object members.
+  auto &ObjMs = C.Stacks.ObjMs;
+  auto ObjMsBase = ObjMs.size();
+  for (auto i = MembersBase; i < Members.size(); ++i) {
+    auto Name = Builder.CreateString(*Members[i].second);
+    ObjMBuilder b1(Builder);
+    b1.add_k(Name);
+    b1.add_v_type(Members[i].first.type);
+    b1.add_v(Members[i].first.off);
+    ObjMs.push_back(b1.Finish());
   }
-  auto v1 = builder.CreateVector(f2);
+  Members.resize(MembersBase);
+  auto v1 = Builder.CreateVector(ObjMs.data() + ObjMsBase,
+                                 ObjMs.size() - ObjMsBase);
+  ObjMs.resize(ObjMsBase);
 
-  ObjBuilder bo(builder);
+  ObjBuilder bo(Builder);
   bo.add_value(v1);
   return {Value::Obj, bo.Finish().Union()};
 }
 
 inline static V_t field_PVStructure_array(
-    flatbuffers::FlatBufferBuilder &builder,
-    epics::pvData::PVValueArray<epics::pvData::PVStructurePtr> const *field,
-    int level) {
-  auto view = field->view();
-  FLOG(level, "structureArray  [size(): {}]", view.size());
-  vector<flatbuffers::Offset<Obj>> v1;
+    Context &C,
+    epics::pvData::PVValueArray<epics::pvData::PVStructurePtr> const *Field,
+    vector<PlanNode> const &Nodes, size_t Index) {
+  auto view = Field->view();
+  auto &Objs = C.Stacks.Objs;
+  auto ObjsBase = Objs.size();
   for (auto &x : view) {
-    FLOG(level, "entry");
-    auto sub = Field(builder, x.get(), 1 + level);
-    if (sub.type != Value::NONE) {
-      if (sub.type != Value::Obj) {
-        FLOG(level, "ERROR mismatched types in the EPICS structure");
-      } else {
-        v1.push_back(sub.off.o);
-      }
+    if (!x) {
+      continue;
+    }
+    auto sub = fbg::Field(C, x.get(), Nodes, Index + 1);
+    if (sub.type == Value::Obj) {
+      Objs.push_back(sub.off.o);
     }
   }
-  auto v2 = builder.CreateVector(v1);
-  ArrayObjBuilder b(builder);
+  auto v2 =
+      C.Builder.CreateVector(Objs.data() + ObjsBase, Objs.size() - ObjsBase);
+  Objs.resize(ObjsBase);
+  ArrayObjBuilder b(C.Builder);
   b.add_value(v2);
   return {Value::ArrayObj, b.Finish().Union()};
 }
 
 inline static V_t field_PVScalar(flatbuffers::FlatBufferBuilder &builder,
                                  epics::pvData::PVScalar const *field,
-                                 int level) {
-  FLOG(level, "scalar");
-  auto stype = field->getScalar()->getScalarType();
+                                 ScalarType stype) {
 #define M(T, B, E, VT)                                                         \
-  if (stype == epics::pvData::ScalarType::E) {                                 \
+  case ScalarType::E: {                                                        \
     auto p1 =                                                                  \
         reinterpret_cast<epics::pvData::PVScalarValue<T> const *>(field);      \
     B b(builder);                                                              \
     b.add_value(p1->get());                                                    \
-    auto off = b.Finish().Union();                                             \
-    FLOG(level, "off: {}  v: {}", off.o, p1->get());                           \
-    return {Value::VT, off};                                                   \
+    return {Value::VT, b.Finish().Union()};                                    \
   }
-  M(int8_t, ByteBuilder, pvByte, Byte);
-  M(int16_t, ShortBuilder, pvShort, Short);
-  M(int32_t, IntBuilder, pvInt, Int);
-  M(int64_t, LongBuilder, pvLong, Long);
-  M(uint8_t, UByteBuilder, pvUByte, UByte);
-  M(uint16_t, UShortBuilder, pvUShort, UShort);
-  M(uint32_t, UIntBuilder, pvUInt, UInt);
-  M(uint64_t, ULongBuilder, pvULong, ULong);
-  M(float, FloatBuilder, pvFloat, Float);
-  M(double, DoubleBuilder, pvDouble, Double);
-#undef M
-  if (stype == epics::pvData::ScalarType::pvString) {
+  switch (stype) {
+    M(int8_t, ByteBuilder, pvByte, Byte);
+    M(int16_t, ShortBuilder, pvShort, Short);
+    M(int32_t, IntBuilder, pvInt, Int);
+    M(int64_t, LongBuilder, pvLong, Long);
+    M(uint8_t, UByteBuilder, pvUByte, UByte);
+    M(uint16_t, UShortBuilder, pvUShort, UShort);
+    M(uint32_t, UIntBuilder, pvUInt, UInt);
+    M(uint64_t, ULongBuilder, pvULong, ULong);
+    M(float, FloatBuilder, pvFloat, Float);
+    M(double, DoubleBuilder, pvDouble, Double);
+    // The schema has no boolean, so it is sent as a byte.
+    M(epics::pvData::boolean, ByteBuilder, pvBoolean, Byte);
+  case ScalarType::pvString: {
     auto p1 =
         reinterpret_cast<epics::pvData::PVScalarValue<std::string> const *>(
             field);
@@ -138,26 +234,17 @@ inline static V_t field_PVScalar(flatbuffers::FlatBufferBuilder &builder,
     b.add_value(s1);
     return {Value::String, b.Finish().Union()};
   }
-  if (stype == epics::pvData::ScalarType::pvBoolean) {
-    FLOG(level, "WARNING boolean handled as byte");
-    auto p1 =
-        reinterpret_cast<epics::pvData::PVScalarValue<bool> const *>(field);
-    ByteBuilder b(builder);
-    b.add_value(p1->get());
-    auto off = b.Finish().Union();
-    FLOG(level, "off: {}", off.o);
-    return {Value::Byte, off};
   }
+#undef M
   return {Value::NONE, 0};
 }
 
 inline static V_t
 field_PVScalar_array(flatbuffers::FlatBufferBuilder &builder,
-                     epics::pvData::PVScalarArray const *field, int level) {
-  FLOG(level, "scalar array");
-  auto stype = field->getScalarArray()->getElementType();
+                     epics::pvData::PVScalarArray const *field,
+                     ScalarType stype) {
 #define M(TC, TB, TF, TE)                                                      \
-  if (stype == epics::pvData::ScalarType::TE) {                                \
+  case ScalarType::TE: {                                                       \
     auto p1 =                                                                  \
         reinterpret_cast<epics::pvData::PVValueArray<TC> const *>(field);      \
     auto view = p1->view();                                                    \
@@ -169,102 +256,101 @@ field_PVScalar_array(flatbuffers::FlatBufferBuilder &builder,
     b.add_value(v1);                                                           \
     return {Value::TF, b.Finish().Union()};                                    \
   }
-  M(int8_t, ArrayByteBuilder, ArrayByte, pvByte);
-  M(int16_t, ArrayShortBuilder, ArrayShort, pvShort);
-  M(int32_t, ArrayIntBuilder, ArrayInt, pvInt);
-  M(int64_t, ArrayLongBuilder, ArrayLong, pvLong);
-  M(uint8_t, ArrayUByteBuilder, ArrayUByte, pvUByte);
-  M(uint16_t, ArrayUShortBuilder, ArrayUShort, pvUShort);
-  M(uint32_t, ArrayUIntBuilder, ArrayUInt, pvUInt);
-  M(uint64_t, ArrayULongBuilder, ArrayULong, pvULong);
-  M(float, ArrayFloatBuilder, ArrayFloat, pvFloat);
-  M(double, ArrayDoubleBuilder, ArrayDouble, pvDouble);
-#undef M
-
-  if (stype == epics::pvData::ScalarType::pvString) {
+  switch (stype) {
+    M(int8_t, ArrayByteBuilder, ArrayByte, pvByte);
+    M(int16_t, ArrayShortBuilder, ArrayShort, pvShort);
+    M(int32_t, ArrayIntBuilder, ArrayInt, pvInt);
+    M(int64_t, ArrayLongBuilder, ArrayLong, pvLong);
+    M(uint8_t, ArrayUByteBuilder, ArrayUByte, pvUByte);
+    M(uint16_t, ArrayUShortBuilder, ArrayUShort, pvUShort);
+    M(uint32_t, ArrayUIntBuilder, ArrayUInt, pvUInt);
+    M(uint64_t, ArrayULongBuilder, ArrayULong, pvULong);
+    M(float, ArrayFloatBuilder, ArrayFloat, pvFloat);
+    M(double, ArrayDoubleBuilder, ArrayDouble, pvDouble);
+    // The schema has no boolean, so it is sent as bytes.
+    M(epics::pvData::boolean, ArrayByteBuilder, ArrayByte, pvBoolean);
+  case ScalarType::pvString: {
     auto p1 =
         reinterpret_cast<epics::pvData::PVValueArray<std::string> const *>(
             field);
-    FLOG(level, "WARNING serializing string arrays is disabled...");
-    return {Value::NONE, 0};
-    auto view = p1->view();
-    vector<flatbuffers::Offset<flatbuffers::String>> v1;
-    for (auto &s0 : view) {
-      v1.push_back(builder.CreateString(s0));
-    }
-    auto v2 = builder.CreateVector(v1);
+    auto v1 = createStringVector(builder, p1->view());
     ArrayStringBuilder b(builder);
-    b.add_value(v2);
+    b.add_value(v1);
     return {Value::ArrayString, b.Finish().Union()};
   }
-  if (stype == epics::pvData::ScalarType::pvBoolean) {
-    FLOG(level, "WARNING array of booleans are not handled so far");
-    return {Value::NONE, 0};
   }
+#undef M
   return {Value::NONE, 0};
 }
 
-inline static V_t field_PVUnion(flatbuffers::FlatBufferBuilder &builder,
-                                epics::pvData::PVUnion const *field,
-                                int level) {
-  FLOG(level, "union");
+inline static V_t field_PVUnion(Context &C,
+                                epics::pvData::PVUnion const *field) {
   auto f3 = field->get();
-  if (f3) {
-    return Field(builder, f3.get(), 1 + level);
+  if (!f3) {
+    // The union does not contain anything:
+    return {Value::NONE, 0};
   }
-  // The union does not contain anything:
-  return {Value::NONE, 0};
+  // The content of a union can change with every update, so it has its own
+  // plan.
+  auto ContentPlan = planFor(C.Stacks, f3->getField());
+  return fbg::Field(C, f3.get(), ContentPlan->Nodes, 0);
 }
 
-V_t Field(flatbuffers::FlatBufferBuilder &builder,
-          epics::pvData::PVField const *field, int level) {
-  FLOG(level, "N: {}", field->getFieldName());
-  auto etype = field->getField()->getType();
-  if (etype == epics::pvData::Type::structure) {
+/// Serializes the field according to the plan node at Index.
+V_t Field(Context &C, PVField const *field, vector<PlanNode> const &Nodes,
+          size_t Index) {
+  auto &Node = Nodes[Index];
+  switch (Node.FieldType) {
+  case Type::structure:
     return field_PVStructure(
-        builder, reinterpret_cast<epics::pvData::PVStructure const *>(field),
-        level + 1);
-  } else if (etype == epics::pvData::Type::structureArray) {
+        C, reinterpret_cast<PVStructure const *>(field), Nodes, Index);
+  case Type::structureArray:
     // Serialize all objects, collect the offsets, and store an array of those.
     return field_PVStructure_array(
-        builder,
+        C,
         reinterpret_cast<
             epics::pvData::PVValueArray<epics::pvData::PVStructurePtr> const *>(
             field),
-        level + 1);
-  } else if (etype == epics::pvData::Type::scalar) {
+        Nodes, Index);
+  case Type::scalar:
     return field_PVScalar(
-        builder, reinterpret_cast<epics::pvData::PVScalar const *>(field),
-        level + 1);
-  } else if (etype == epics::pvData::Type::scalarArray) {
+        C.Builder, reinterpret_cast<epics::pvData::PVScalar const *>(field),
+        Node.ElementType);
+  case Type::scalarArray:
     return field_PVScalar_array(
-        builder, reinterpret_cast<epics::pvData::PVScalarArray const *>(field),
-        level + 1);
-  } else if (etype == epics::pvData::Type::union_) {
+        C.Builder,
+        reinterpret_cast<epics::pvData::PVScalarArray const *>(field),
+        Node.ElementType);
+  case Type::union_:
     return field_PVUnion(
-        builder, reinterpret_cast<epics::pvData::PVUnion const *>(field),
-        level + 1);
-  } else if (etype == epics::pvData::Type::unionArray) {
-    FLOG(level, "union array not yet supported");
-    return {Value::NONE, 0};
+        C, reinterpret_cast<epics::pvData::PVUnion const *>(field));
+  case Type::unionArray:
+    // Not supported yet.
+    break;
   }
-
-  FLOG(level, "ERROR unknown type");
   return {Value::NONE, 0};
 }
 
+/// Serializes the field using the cached plan of its introspection interface.
 V_t Field(flatbuffers::FlatBufferBuilder &builder,
-          epics::pvData::PVFieldPtr const &field, int level) {
-  return Field(builder, field.get(), level);
+          epics::pvData::PVFieldPtr const &field) {
+  auto &Stacks = scratch();
+  Context C{builder, Stacks};
+  auto FieldPlan = planFor(Stacks, field->getField());
+  return Field(C, field.get(), FieldPlan->Nodes, 0);
 }
 }
 
 class Converter : public MakeFlatBufferFromPVStructure {
 public:
   FlatBufs::FlatbufferMessage::uptr convert(EpicsPVUpdate const &up) override {
-    // Passing initial size:
+    return convertWithSizeHint(up, 0);
+  }
+
+  FlatBufs::FlatbufferMessage::uptr
+  convertWithSizeHint(EpicsPVUpdate const &up, uint32_t InitialSize) override {
     auto &pvstr = up.epics_pvstr;
-    auto fb = make_unique<FlatBufs::FlatbufferMessage>();
+    auto fb = FlatBufs::FlatbufferMessage::create(InitialSize);
     auto builder = fb->builder.get();
 
     flatbuffers::Offset<void> fwdinfo = 0;
@@ -289,7 +375,7 @@ public:
     }
 
     auto n = builder->CreateString(up.channel);
-    auto vF = fbg::Field(*builder, pvstr, llevel);
+    auto vF = fbg::Field(*builder, pvstr);
     f143_structure::StructureBuilder b(*builder);
     b.add_name(n);
     b.add_value_type(vF.type);
@@ -319,13 +405,8 @@ public:
     if (it != config_ints.end()) {
       do_fwdinfo = it->second != 0;
     }
-    it = config_ints.find("llevel");
-    if (it != config_ints.end()) {
-      llevel = it->second;
-    }
   }
   bool do_fwdinfo = false;
-  int llevel = 1000;
 };
 
 class Info : public SchemaInfo {
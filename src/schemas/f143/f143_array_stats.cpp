@@ -0,0 +1,222 @@
+#include "../../ArrayKernels.h"
+#include "../../EpicsPVUpdate.h"
+#include "../../SchemaRegistry.h"
+#include "../../helper.h"
+#include "../../logger.h"
+#include "schemas/f143_structure_generated.h"
+#include <algorithm>
+
+/// \file
+/// Converter which forwards a summary of array PVs instead of the array
+/// itself, as an f143 structure with the members count, min, max, sum, mean
+/// and optionally decimated.
+
+namespace FlatBufs {
+namespace f143_array_stats {
+
+using namespace f143_structure;
+using Forwarder::ArrayKernels::summarize;
+
+struct ArrayStatistics {
+  uint64_t Count = 0;
+  double Min = 0;
+  double Max = 0;
+  double Sum = 0;
+  flatbuffers::Offset<flatbuffers::Vector<double>> Decimated;
+};
+
+/// Summarizes the array in a single pass. If Points is not zero, the array
+/// is also split into that many blocks of consecutive elements whose means
+/// are written to the builder as the decimated array. Arrays with no more
+/// elements than Points are sent as they are.
+template <typename T>
+static ArrayStatistics summarizeArray(flatbuffers::FlatBufferBuilder &Builder,
+                                      epics::pvData::PVScalarArray const *Field,
+                                      size_t Points) {
+  auto View =
+      static_cast<epics::pvData::PVValueArray<T> const *>(Field)->view();
+  auto Data = View.data();
+  size_t Count = View.size();
+  ArrayStatistics Result;
+  Result.Count = Count;
+  double *Decimated = nullptr;
+  if (Points > 0) {
+    Result.Decimated = Builder.CreateUninitializedVector(
+        std::min(Count, Points), &Decimated);
+  }
+  if (Points == 0 || Count <= Points) {
+    auto Summary = summarize(Data, Count);
+    Result.Min = Summary.Min;
+    Result.Max = Summary.Max;
+    Result.Sum = Summary.Sum;
+    if (Decimated != nullptr) {
+      std::copy(Data, Data + Count, Decimated);
+    }
+    return Result;
+  }
+  // The summaries of the blocks together give the summary of the array.
+  for (size_t Block = 0; Block < Points; ++Block) {
+    auto Begin = Block * Count / Points;
+    auto End = (Block + 1) * Count / Points;
+    auto Summary = summarize(Data + Begin, End - Begin);
+    Decimated[Block] = Summary.mean();
+    if (Block == 0 || Summary.Min < Result.Min) {
+      Result.Min = Summary.Min;
+    }
+    if (Block == 0 || Summary.Max > Result.Max) {
+      Result.Max = Summary.Max;
+    }
+    Result.Sum += Summary.Sum;
+  }
+  return Result;
+}
+
+/// Returns false if the element type can not be summarized.
+static bool summarizeArray(flatbuffers::FlatBufferBuilder &Builder,
+                           epics::pvData::PVScalarArray const *Field,
+                           size_t Points, ArrayStatistics &Result) {
+  using epics::pvData::ScalarType;
+#define M(T, E)                                                                \
+  case ScalarType::E:                                                          \
+    Result = summarizeArray<T>(Builder, Field, Points);                        \
+    return true;
+  switch (Field->getScalarArray()->getElementType()) {
+    M(int8_t, pvByte);
+    M(int16_t, pvShort);
+    M(int32_t, pvInt);
+    M(int64_t, pvLong);
+    M(uint8_t, pvUByte);
+    M(uint16_t, pvUShort);
+    M(uint32_t, pvUInt);
+    M(uint64_t, pvULong);
+    M(float, pvFloat);
+    M(double, pvDouble);
+  default:
+    break;
+  }
+#undef M
+  return false;
+}
+
+class Converter : public MakeFlatBufferFromPVStructure {
+public:
+  FlatBufs::FlatbufferMessage::uptr convert(EpicsPVUpdate const &up) override {
+    return convertWithSizeHint(up, 0);
+  }
+
+  FlatBufs::FlatbufferMessage::uptr
+  convertWithSizeHint(EpicsPVUpdate const &up, uint32_t InitialSize) override {
+    auto &pvstr = up.epics_pvstr;
+    auto PVArray = pvstr->getSubField<epics::pvData::PVScalarArray>("value");
+    if (!PVArray) {
+      LOG_LIMITED(6, "f143-array-stats: {} is not an array", up.channel);
+      return nullptr;
+    }
+    auto fb = FlatBufs::FlatbufferMessage::create(InitialSize);
+    auto builder = fb->builder.get();
+    ArrayStatistics Statistics;
+    if (!summarizeArray(*builder, PVArray.get(), DecimatedPoints, Statistics)) {
+      LOG_LIMITED(6, "f143-array-stats: can not summarize {}", up.channel);
+      return nullptr;
+    }
+
+    flatbuffers::Offset<void> fwdinfo = 0;
+    if (do_fwdinfo) {
+      fwdinfo_1_tBuilder bf(*builder);
+      bf.add_seq_fwd(up.seq_fwd);
+      bf.add_ts_fwd(up.ts_epics_monitor);
+      fwdinfo = bf.Finish().Union();
+    }
+
+    flatbuffers::Offset<ObjM> Members[6];
+    size_t MemberCount = 0;
+    auto addMember = [&](char const *Name, Value Type,
+                         flatbuffers::Offset<void> Offset) {
+      auto k = builder->CreateString(Name);
+      ObjMBuilder b1(*builder);
+      b1.add_k(k);
+      b1.add_v_type(Type);
+      b1.add_v(Offset);
+      Members[MemberCount++] = b1.Finish();
+    };
+    auto addDouble = [&](char const *Name, double Number) {
+      DoubleBuilder b(*builder);
+      b.add_value(Number);
+      addMember(Name, Value::Double, b.Finish().Union());
+    };
+    {
+      ULongBuilder b(*builder);
+      b.add_value(Statistics.Count);
+      addMember("count", Value::ULong, b.Finish().Union());
+    }
+    addDouble("min", Statistics.Min);
+    addDouble("max", Statistics.Max);
+    addDouble("sum", Statistics.Sum);
+    addDouble("mean", Statistics.Count == 0
+                          ? 0
+                          : Statistics.Sum / Statistics.Count);
+    if (DecimatedPoints > 0) {
+      ArrayDoubleBuilder b(*builder);
+      b.add_value(Statistics.Decimated);
+      addMember("decimated", Value::ArrayDouble, b.Finish().Union());
+    }
+    auto v1 = builder->CreateVector(Members, MemberCount);
+    ObjBuilder bo(*builder);
+    bo.add_value(v1);
+    auto vF = bo.Finish().Union();
+
+    auto n = builder->CreateString(up.channel);
+    f143_structure::StructureBuilder b(*builder);
+    b.add_name(n);
+    b.add_value_type(Value::Obj);
+    b.add_value(vF);
+    if (auto pvTimeStamp =
+            pvstr->getSubField<epics::pvData::PVStructure>("timeStamp")) {
+      uint64_t ts = (uint64_t)pvTimeStamp
+                        ->getSubField<epics::pvData::PVScalarValue<int64_t>>(
+                            "secondsPastEpoch")
+                        ->get();
+      ts *= 1000000000;
+      ts += pvTimeStamp
+                ->getSubField<epics::pvData::PVScalarValue<int32_t>>(
+                    "nanoseconds")
+                ->get();
+      b.add_timestamp(ts);
+    }
+    b.add_fwdinfo_type(forwarder_internal::fwdinfo_1_t);
+    b.add_fwdinfo(fwdinfo);
+    FinishStructureBuffer(*builder, b.Finish());
+    return fb;
+  }
+
+  void
+  config(std::map<std::string, int64_t> const &config_ints,
+         std::map<std::string, std::string> const &config_strings) override {
+    auto it = config_ints.find("fwdinfo");
+    if (it != config_ints.end()) {
+      do_fwdinfo = it->second != 0;
+    }
+    it = config_ints.find("decimate");
+    if (it != config_ints.end()) {
+      DecimatedPoints = static_cast<size_t>(std::max<int64_t>(0, it->second));
+    }
+  }
+
+  bool do_fwdinfo = false;
+  /// Number of points of the decimated array, none if zero.
+  size_t DecimatedPoints = 0;
+};
+
+class Info : public SchemaInfo {
+public:
+  MakeFlatBufferFromPVStructure::ptr create_converter() override;
+};
+
+MakeFlatBufferFromPVStructure::ptr Info::create_converter() {
+  return MakeFlatBufferFromPVStructure::ptr(new Converter);
+}
+
+FlatBufs::SchemaRegistry::Registrar<Info>
+    g_registrar_info("f143-array-stats", Info::ptr(new Info));
+}
+}
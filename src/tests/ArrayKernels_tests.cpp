@@ -0,0 +1,142 @@
+#include "../ArrayKernels.h"
+#include <chrono>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace Forwarder::ArrayKernels;
+
+namespace {
+
+/// Runs the test body with every instruction set which the CPU supports.
+class ArrayKernelsTest : public ::testing::TestWithParam<InstructionSet> {
+public:
+  void SetUp() override {
+    if (!supported(GetParam())) {
+      Skip = true;
+      return;
+    }
+    ASSERT_EQ(GetParam(), useInstructionSet(GetParam()));
+  }
+  void TearDown() override { useInstructionSet(InstructionSet::AVX2); }
+  bool Skip = false;
+};
+
+template <typename T> std::vector<T> randomArray(size_t Count) {
+  std::mt19937 Random(Count);
+  std::uniform_int_distribution<int64_t> Distribution(
+      std::numeric_limits<T>::min(), std::numeric_limits<T>::max());
+  std::vector<T> Array(Count);
+  for (auto &Element : Array) {
+    Element = static_cast<T>(Distribution(Random));
+  }
+  return Array;
+}
+
+template <typename T> std::vector<T> randomRealArray(size_t Count) {
+  std::mt19937 Random(Count);
+  std::uniform_real_distribution<T> Distribution(-1e3, 1e3);
+  std::vector<T> Array(Count);
+  for (auto &Element : Array) {
+    Element = Distribution(Random);
+  }
+  return Array;
+}
+
+template <typename T> void checkSummary(std::vector<T> const &Array) {
+  auto Result = summarize(Array.data(), Array.size());
+  ASSERT_EQ(Array.size(), Result.Count);
+  if (Array.empty()) {
+    ASSERT_EQ(0, Result.Sum);
+    return;
+  }
+  T Min = Array[0];
+  T Max = Array[0];
+  long double Sum = 0;
+  for (auto Element : Array) {
+    Min = std::min(Min, Element);
+    Max = std::max(Max, Element);
+    Sum += Element;
+  }
+  ASSERT_EQ(Min, Result.Min);
+  ASSERT_EQ(Max, Result.Max);
+  ASSERT_NEAR(static_cast<double>(Sum), Result.Sum,
+              1e-9 * Array.size() * std::max<double>(1, std::fabs(Max)));
+}
+
+std::vector<size_t> const Sizes{0, 1, 7, 8, 15, 16, 17, 31, 33, 1000, 100003};
+}
+
+TEST_P(ArrayKernelsTest, summarize_integer_arrays) {
+  if (Skip) {
+    return;
+  }
+  for (auto Size : Sizes) {
+    checkSummary(randomArray<int8_t>(Size));
+    checkSummary(randomArray<uint8_t>(Size));
+    checkSummary(randomArray<int16_t>(Size));
+    checkSummary(randomArray<uint16_t>(Size));
+    checkSummary(randomArray<int32_t>(Size));
+    checkSummary(randomArray<uint32_t>(Size));
+    checkSummary(randomArray<int64_t>(Size));
+  }
+}
+
+TEST_P(ArrayKernelsTest, summarize_floating_point_arrays) {
+  if (Skip) {
+    return;
+  }
+  for (auto Size : Sizes) {
+    checkSummary(randomRealArray<float>(Size));
+    checkSummary(randomRealArray<double>(Size));
+  }
+}
+
+TEST_P(ArrayKernelsTest, sum_of_int16_does_not_overflow) {
+  if (Skip) {
+    return;
+  }
+  // More elements than fit into one block of 32 bit partial sums.
+  std::vector<int16_t> Array(1 << 20, std::numeric_limits<int16_t>::min());
+  auto Result = summarize(Array.data(), Array.size());
+  ASSERT_EQ(-32768.0 * Array.size(), Result.Sum);
+  ASSERT_EQ(-32768.0, Result.mean());
+}
+
+/// Compares the instruction sets on multi-megabyte arrays. Run with
+/// --gtest_also_run_disabled_tests.
+TEST_P(ArrayKernelsTest, DISABLED_benchmark_large_arrays) {
+  if (Skip) {
+    return;
+  }
+  size_t const Size = 8 * 1024 * 1024;
+  int const Repetitions = 20;
+  auto Shorts = randomArray<int16_t>(Size);
+  auto Doubles = randomRealArray<double>(Size);
+  double Sink = 0;
+  auto Start = std::chrono::steady_clock::now();
+  for (int i = 0; i < Repetitions; ++i) {
+    Sink += summarize(Shorts.data(), Size).Sum;
+  }
+  auto SummarizeShorts = std::chrono::steady_clock::now();
+  for (int i = 0; i < Repetitions; ++i) {
+    Sink += summarize(Doubles.data(), Size).Sum;
+  }
+  auto SummarizeDoubles = std::chrono::steady_clock::now();
+  auto Rate = [Size, Repetitions](std::chrono::steady_clock::duration D,
+                                  size_t ElementSize) {
+    return Size * ElementSize * Repetitions /
+           std::chrono::duration<double>(D).count() / (1 << 30);
+  };
+  std::cout << instructionSetName(GetParam()) << ": summarize int16 "
+            << Rate(SummarizeShorts - Start, 2) << " GiB/s, summarize double "
+            << Rate(SummarizeDoubles - SummarizeShorts, 8) << " GiB/s\n";
+  ASSERT_NE(0, Sink);
+}
+
+INSTANTIATE_TEST_CASE_P(InstructionSets, ArrayKernelsTest,
+                        ::testing::Values(InstructionSet::Scalar,
+                                          InstructionSet::AVX2));
@@ -0,0 +1,51 @@
+#include "../CURLReporter.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace Forwarder {
+
+class CURLReporterTest : public ::testing::Test {
+protected:
+  /// Stops the sender thread so that the queue is not drained.
+  void stopSender(CURLReporter &Reporter) {
+    {
+      std::unique_lock<std::mutex> lock(Reporter.QueueMutex);
+      Reporter.Running = false;
+    }
+    Reporter.QueueNotEmpty.notify_all();
+    if (Reporter.SenderThread.joinable()) {
+      Reporter.SenderThread.join();
+    }
+  }
+
+  void enqueue(CURLReporter &Reporter, std::string Body) {
+    Reporter.enqueue({"http://localhost:8086/write", std::move(Body)});
+  }
+
+  std::vector<std::string> queued(CURLReporter &Reporter) {
+    std::unique_lock<std::mutex> lock(Reporter.QueueMutex);
+    std::vector<std::string> Bodies;
+    for (auto const &Msg : Reporter.Queue) {
+      Bodies.push_back(Msg.Body);
+    }
+    return Bodies;
+  }
+};
+}
+
+using namespace Forwarder;
+
+TEST_F(CURLReporterTest, full_queue_drops_the_oldest_message) {
+  CURLReporter Reporter(2);
+  stopSender(Reporter);
+  enqueue(Reporter, "first");
+  enqueue(Reporter, "second");
+  ASSERT_EQ(0u, Reporter.droppedCount());
+  enqueue(Reporter, "third");
+  ASSERT_EQ(1u, Reporter.droppedCount());
+  ASSERT_EQ((std::vector<std::string>{"second", "third"}), queued(Reporter));
+  enqueue(Reporter, "fourth");
+  ASSERT_EQ(2u, Reporter.droppedCount());
+  ASSERT_EQ((std::vector<std::string>{"third", "fourth"}), queued(Reporter));
+}
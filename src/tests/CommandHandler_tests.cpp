@@ -1,7 +1,9 @@
 #include "../CommandHandler.h"
 #include "../ConfigParser.h"
 #include "../MainOpt.h"
+#include "../helper.h"
 #include "Forwarder.h"
+#include <fmt/format.h>
 #include <gtest/gtest.h>
 #include <nlohmann/json.hpp>
 
@@ -112,6 +114,200 @@ TEST(CommandHandlerTest, stop_command_removes_stream_correctly) {
   ASSERT_EQ(0u, Main.streams.size());
 }
 
+TEST(CommandHandlerTest, batch_skips_streams_stopped_in_the_same_batch) {
+  std::string AddJson = R"({
+                            "cmd": "add",
+                            "streams": [
+                              {
+                                "channel": "my_channel_name",
+                                "channel_provider_type": "ca"
+                              },
+                              {
+                                "channel": "my_channel_name_2",
+                                "channel_provider_type": "pva"
+                              }
+                            ]
+                           })";
+  std::string RemoveJson = R"({
+                               "cmd": "stop_channel",
+                               "channel": "my_channel_name"
+                              })";
+
+  Forwarder::MainOpt MainOpt;
+  Forwarder::Forwarder Main(MainOpt);
+  Forwarder::ConfigCB Config(Main);
+
+  Config.batch({AddJson, "not json", RemoveJson});
+
+  ASSERT_EQ(1u, Main.streams.size());
+  ASSERT_EQ("my_channel_name_2", Main.streams[0]->channel_info().channel_name);
+}
+
+TEST(CommandHandlerTest, batch_applies_adds_after_stop_all) {
+  std::string AddJson = R"({
+                            "cmd": "add",
+                            "streams": [
+                              {
+                                "channel": "my_channel_name",
+                                "channel_provider_type": "ca"
+                              }
+                            ]
+                           })";
+  std::string StopAllJson = R"({
+                                "cmd": "stop_all"
+                               })";
+
+  Forwarder::MainOpt MainOpt;
+  Forwarder::Forwarder Main(MainOpt);
+  Forwarder::ConfigCB Config(Main);
+
+  Config.batch({AddJson, AddJson, StopAllJson, AddJson});
+
+  ASSERT_EQ(1u, Main.streams.size());
+}
+
+TEST(CommandHandlerTest, set_command_changes_only_what_differs) {
+  std::string AddJson = R"({
+                            "cmd": "add",
+                            "streams": [
+                              {
+                                "channel": "removed",
+                                "channel_provider_type": "ca"
+                              },
+                              {
+                                "channel": "unchanged",
+                                "channel_provider_type": "ca"
+                              },
+                              {
+                                "channel": "changed",
+                                "channel_provider_type": "ca"
+                              }
+                            ]
+                           })";
+  std::string SetJson = R"({
+                            "cmd": "set",
+                            "streams": [
+                              {
+                                "channel": "unchanged",
+                                "channel_provider_type": "ca"
+                              },
+                              {
+                                "channel": "changed",
+                                "channel_provider_type": "pva"
+                              },
+                              {
+                                "channel": "added",
+                                "channel_provider_type": "ca"
+                              }
+                            ]
+                           })";
+
+  Forwarder::MainOpt MainOpt;
+  Forwarder::Forwarder Main(MainOpt);
+  Forwarder::ConfigCB Config(Main);
+
+  Config(AddJson);
+  auto Unchanged = Main.streams.find("unchanged");
+  ASSERT_EQ(1u, Unchanged.size());
+  Config(SetJson);
+
+  ASSERT_EQ(3u, Main.streams.size());
+  ASSERT_EQ(0u, Main.streams.find("removed").size());
+  ASSERT_EQ(Unchanged, Main.streams.find("unchanged"));
+  auto Changed = Main.streams.find("changed");
+  ASSERT_EQ(1u, Changed.size());
+  ASSERT_EQ("pva", Changed[0]->channel_info().provider_type);
+  ASSERT_EQ(1u, Main.streams.find("added").size());
+}
+
+TEST(CommandHandlerTest, set_command_applies_a_changed_update_period) {
+  auto SetJson = [](uint32_t PeriodMS) {
+    return fmt::format(R"({{
+                            "cmd": "set",
+                            "streams": [
+                              {{
+                                "channel": "periodic",
+                                "channel_provider_type": "ca",
+                                "pv_update_period": {}
+                              }}
+                            ]
+                           }})",
+                       PeriodMS);
+  };
+
+  Forwarder::MainOpt MainOpt;
+  Forwarder::Forwarder Main(MainOpt);
+  Forwarder::ConfigCB Config(Main);
+
+  Config(SetJson(100));
+  auto First = Main.streams.find("periodic");
+  ASSERT_EQ(1u, First.size());
+  Config(SetJson(100));
+  ASSERT_EQ(First, Main.streams.find("periodic"));
+  Config(SetJson(200));
+
+  auto Changed = Main.streams.find("periodic");
+  ASSERT_EQ(1u, Changed.size());
+  ASSERT_NE(First, Changed);
+  ASSERT_EQ(200u, Changed[0]->settings().PVUpdatePeriodMS);
+}
+
+namespace {
+/// An EPICS client which stays connected until it is stopped.
+class StoppableEpicsClient : public EpicsClient::EpicsClientInterface {
+public:
+  int emit(std::shared_ptr<FlatBufs::EpicsPVUpdate> Update) override {
+    return 0;
+  }
+  int stop() override {
+    Connected = false;
+    status_ = -1;
+    return 0;
+  }
+  void errorInEpics() override { status_ = -1; }
+  int status() override { return status_; }
+  bool connected() override { return Connected; }
+
+private:
+  bool Connected{true};
+  int status_{0};
+};
+}
+
+TEST(CommandHandlerTest, failed_set_command_keeps_the_old_stream_running) {
+  std::string SetJson = R"({
+                            "cmd": "set",
+                            "streams": [
+                              {
+                                "channel": "kept",
+                                "channel_provider_type": "ca",
+                                "converter": {
+                                  "schema": "no-such-schema",
+                                  "topic": "some_topic"
+                                }
+                              }
+                            ]
+                           })";
+
+  Forwarder::MainOpt MainOpt;
+  Forwarder::Forwarder Main(MainOpt);
+  Forwarder::ConfigCB Config(Main);
+
+  auto Old = std::make_shared<Forwarder::Stream>(
+      Forwarder::ChannelInfo{"ca", "kept"},
+      ::make_unique<StoppableEpicsClient>(),
+      std::make_shared<moodycamel::ConcurrentQueue<
+          std::shared_ptr<FlatBufs::EpicsPVUpdate>>>());
+  Main.streams.add(Old);
+  Config(SetJson);
+
+  auto Kept = Main.streams.find("kept");
+  ASSERT_EQ(1u, Kept.size());
+  ASSERT_EQ(Old, Kept[0]);
+  ASSERT_TRUE(Old->connected());
+  ASSERT_EQ(0, Old->status());
+}
+
 class ExtractCommandsTest : public ::testing::TestWithParam<const char *> {
   virtual void SetUp() { command = (*GetParam()); }
   virtual void TearDown() {}
@@ -139,5 +335,6 @@ TEST_P(ExtractCommandsTest, extracting_command_gets_command_name) {
 }
 
 INSTANTIATE_TEST_CASE_P(InstantiationName, ExtractCommandsTest,
-                        ::testing::Values("add", "stop_channel", "stop_all",
-                                          "exit", "unknown_command"));
+                        ::testing::Values("add", "set", "stop_channel",
+                                          "stop_all", "exit",
+                                          "unknown_command"));
@@ -298,6 +298,42 @@ TEST(ConfigParserTest, extracting_conversion_threads_sets_value) {
   ASSERT_EQ(3u, Settings.ConversionThreads);
 }
 
+TEST(ConfigParserTest, epics_client_contexts_default_to_one) {
+  Forwarder::ConfigParser Config;
+  Config.setJsonFromString("{}");
+
+  auto Settings = Config.extractConfiguration();
+
+  ASSERT_EQ(1u, Settings.EpicsClientContexts);
+}
+
+TEST(ConfigParserTest, extracting_epics_client_contexts_gets_value) {
+  std::string RawJson = R"({
+                            "epics-client-contexts": 4
+                           })";
+
+  Forwarder::ConfigParser Config;
+  Config.setJsonFromString(RawJson);
+
+  auto Settings = Config.extractConfiguration();
+
+  ASSERT_EQ(4u, Settings.EpicsClientContexts);
+}
+
+TEST(ConfigParserTest, native_ca_is_off_by_default) {
+  Forwarder::ConfigParser Config;
+  Config.setJsonFromString("{}");
+
+  ASSERT_FALSE(Config.extractConfiguration().NativeCA);
+}
+
+TEST(ConfigParserTest, extracting_native_ca_gets_value) {
+  Forwarder::ConfigParser Config;
+  Config.setJsonFromString(R"({"native-ca": true})");
+
+  ASSERT_TRUE(Config.extractConfiguration().NativeCA);
+}
+
 TEST(ConfigParserTest, no_conversion_worker_queue_size_sets_default) {
   std::string RawJson = "{}";
 
@@ -508,3 +544,55 @@ TEST(ConfigParserTest, extracting_converter_info_with_no_schema_throws) {
 
   ASSERT_ANY_THROW(Config.extractConfiguration());
 }
+
+TEST(ConfigParserTest, extracting_streams_setting_gets_monitor_settings) {
+  std::string RawJson = R"({
+                            "streams": [
+                               {
+                                 "channel": "my_channel_name",
+                                 "monitor_queue_size": 32,
+                                 "monitor_pipeline": true,
+                                 "monitor_fields": ["value", "timeStamp"]
+                               },
+                               {
+                                 "channel": "my_channel_name_2"
+                               }
+                            ]
+                           })";
+
+  Forwarder::ConfigParser Config;
+  Config.setJsonFromString(RawJson);
+  auto Settings = Config.extractConfiguration();
+
+  ASSERT_EQ(2u, Settings.StreamsInfo.size());
+  auto const &Monitor = Settings.StreamsInfo[0].Monitor;
+  ASSERT_EQ(32u, Monitor.QueueSize);
+  ASSERT_TRUE(Monitor.Pipeline);
+  ASSERT_EQ(2u, Monitor.Fields.size());
+  ASSERT_EQ("timeStamp", Monitor.Fields[1]);
+  auto const &DefaultMonitor = Settings.StreamsInfo[1].Monitor;
+  ASSERT_EQ(0u, DefaultMonitor.QueueSize);
+  ASSERT_FALSE(DefaultMonitor.Pipeline);
+  ASSERT_TRUE(DefaultMonitor.Fields.empty());
+}
+
+TEST(ConfigParserTest, extracting_streams_setting_gets_pv_update_period) {
+  std::string RawJson = R"({
+                            "streams": [
+                               {
+                                 "channel": "my_channel_name",
+                                 "pv_update_period": 500
+                               },
+                               {
+                                 "channel": "my_channel_name_2"
+                               }
+                            ]
+                           })";
+
+  Forwarder::ConfigParser Config;
+  Config.setJsonFromString(RawJson);
+  auto Settings = Config.extractConfiguration();
+
+  ASSERT_EQ(500u, Settings.StreamsInfo[0].PVUpdatePeriodMS);
+  ASSERT_EQ(0u, Settings.StreamsInfo[1].PVUpdatePeriodMS);
+}
@@ -37,6 +37,25 @@ TEST(EpicsClientMonitorTest,
   ASSERT_FALSE(PVUpdateRing->try_dequeue(ThirdValue));
 }
 
+TEST(EpicsClientMonitorTest, test_emitted_cached_value_is_marked_as_repeated) {
+  ChannelInfo ChannelInfo;
+  ChannelInfo.channel_name = "SIM:Spd";
+  ChannelInfo.provider_type = "ca";
+
+  auto UpdatePtr = std::make_shared<FlatBufs::EpicsPVUpdate>();
+
+  auto PVUpdateRing = std::make_shared<
+      moodycamel::ConcurrentQueue<std::shared_ptr<FlatBufs::EpicsPVUpdate>>>();
+  EpicsClient::EpicsClientMonitor Client(ChannelInfo, PVUpdateRing);
+
+  Client.emit(UpdatePtr);
+  ASSERT_FALSE(UpdatePtr->Repeated);
+
+  // The cached value is the same update, now marked as a repeat
+  Client.emitCachedValue();
+  ASSERT_TRUE(UpdatePtr->Repeated);
+}
+
 TEST(
     EpicsClientMonitorTest,
     test_cached_value_is_not_pushed_when_emit_is_called_without_emitCachedValue) {
@@ -107,3 +126,21 @@ TEST(EpicsClientMonitorTest,
   auto FirstValue = std::shared_ptr<FlatBufs::EpicsPVUpdate>();
   ASSERT_FALSE(PVUpdateRing->try_dequeue(FirstValue));
 }
+
+TEST(EpicsClientMonitorTest, default_monitor_request_asks_for_used_fields) {
+  MonitorSettings Settings;
+  ASSERT_EQ("field(value,timeStamp,alarm)",
+            EpicsClient::monitorRequestString(Settings));
+}
+
+TEST(EpicsClientMonitorTest, monitor_request_contains_record_options) {
+  MonitorSettings Settings;
+  Settings.QueueSize = 16;
+  Settings.Pipeline = true;
+  Settings.Fields = {"value", "timeStamp"};
+  ASSERT_EQ("record[queueSize=16,pipeline=true]field(value,timeStamp)",
+            EpicsClient::monitorRequestString(Settings));
+  Settings.QueueSize = 0;
+  ASSERT_EQ("record[pipeline=true]field(value,timeStamp)",
+            EpicsClient::monitorRequestString(Settings));
+}
@@ -58,3 +58,72 @@ TEST(EpicsClientRandomTest,
   // we get are different
   ASSERT_GT(abs(FirstGeneratedPVValue - SecondGeneratedPVValue), 0.00001);
 }
+
+TEST(EpicsClientRandomTest, fake_PV_has_alarm_and_timestamp) {
+  auto RingBuffer = std::make_shared<
+      moodycamel::ConcurrentQueue<std::shared_ptr<FlatBufs::EpicsPVUpdate>>>();
+  ChannelInfo ChannelInformation{"", ""};
+  auto EpicsClient =
+      EpicsClient::EpicsClientRandom(ChannelInformation, RingBuffer);
+  EpicsClient.generateFakePVUpdate();
+  std::shared_ptr<FlatBufs::EpicsPVUpdate> PV;
+  ASSERT_TRUE(RingBuffer->try_dequeue(PV));
+  ASSERT_TRUE(PV->epics_pvstr->getSubField("alarm.severity"));
+  auto Seconds = PV->epics_pvstr->getSubField<epics::pvData::PVLong>(
+      "timeStamp.secondsPastEpoch");
+  ASSERT_TRUE(Seconds);
+  ASSERT_EQ(PV->ts_epics_monitor / 1000000000, uint64_t(Seconds->get()));
+}
+
+TEST(EpicsClientRandomTest, fake_PV_arrays_of_all_types) {
+  auto RingBuffer = std::make_shared<
+      moodycamel::ConcurrentQueue<std::shared_ptr<FlatBufs::EpicsPVUpdate>>>();
+  ChannelInfo ChannelInformation{"", ""};
+  auto EpicsClient =
+      EpicsClient::EpicsClientRandom(ChannelInformation, RingBuffer);
+  for (int i = epics::pvData::pvBoolean; i <= epics::pvData::pvString; ++i) {
+    EpicsClient::FakePVSettings Settings;
+    auto Type = static_cast<epics::pvData::ScalarType>(i);
+    Settings.Type = epics::pvData::ScalarTypeFunc::name(Type);
+    Settings.ArraySize = 17;
+    EpicsClient.setSettings(Settings);
+    EpicsClient.generateFakePVUpdate();
+    std::shared_ptr<FlatBufs::EpicsPVUpdate> PV;
+    ASSERT_TRUE(RingBuffer->try_dequeue(PV));
+    auto Array =
+        PV->epics_pvstr->getSubField<epics::pvData::PVScalarArray>("value");
+    ASSERT_TRUE(Array);
+    ASSERT_EQ(Type, Array->getScalarArray()->getElementType());
+    ASSERT_EQ(17u, Array->getLength());
+  }
+}
+
+TEST(EpicsClientRandomTest, arrival_patterns_generate_the_mean_rate) {
+  auto RingBuffer = std::make_shared<
+      moodycamel::ConcurrentQueue<std::shared_ptr<FlatBufs::EpicsPVUpdate>>>();
+  ChannelInfo ChannelInformation{"", ""};
+  auto EpicsClient =
+      EpicsClient::EpicsClientRandom(ChannelInformation, RingBuffer);
+  EpicsClient::FakePVSettings Settings;
+  Settings.UpdatesPerPeriod = 3;
+  Settings.BurstSize = 30;
+  for (auto Arrival : {"periodic", "poisson", "bursty"}) {
+    Settings.Arrival = EpicsClient::parseFakePVArrival(Arrival);
+    EpicsClient.setSettings(Settings);
+    size_t Total = 0;
+    for (int i = 0; i < 10000; ++i) {
+      auto Count = EpicsClient.generateFakePVUpdates();
+      if (Settings.Arrival == EpicsClient::FakePVArrival::Bursty) {
+        ASSERT_TRUE(Count == 0 || Count == 30);
+      }
+      Total += Count;
+    }
+    ASSERT_EQ(Total, RingBuffer->size_approx());
+    ASSERT_NEAR(30000, Total, 3000);
+    std::shared_ptr<FlatBufs::EpicsPVUpdate> PV;
+    while (RingBuffer->try_dequeue(PV)) {
+    }
+  }
+  ASSERT_THROW(EpicsClient::parseFakePVArrival("sometimes"),
+               std::runtime_error);
+}
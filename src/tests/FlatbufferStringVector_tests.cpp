@@ -0,0 +1,44 @@
+#include "../FlatbufferStringVector.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+using FlatBufs::createStringVector;
+using StringVector =
+    flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>>;
+
+static void checkRoundTrip(std::vector<std::string> const &Strings,
+                           std::string const &Before) {
+  flatbuffers::FlatBufferBuilder Builder;
+  if (!Before.empty()) {
+    // Data in front of the strings which leaves the builder unaligned.
+    Builder.CreateString(Before);
+  }
+  auto Vector = createStringVector(Builder, Strings);
+  Builder.Finish(Vector);
+  flatbuffers::Verifier Verifier(Builder.GetBufferPointer(),
+                                 Builder.GetSize());
+  auto Result = flatbuffers::GetRoot<StringVector>(Builder.GetBufferPointer());
+  ASSERT_TRUE(Verifier.VerifyVector(Result));
+  ASSERT_TRUE(Verifier.VerifyVectorOfStrings(Result));
+  ASSERT_EQ(Strings.size(), Result->size());
+  for (size_t i = 0; i < Strings.size(); ++i) {
+    ASSERT_EQ(Strings[i], Result->Get(i)->str());
+  }
+}
+
+TEST(FlatbufferStringVectorTest, empty_vector) { checkRoundTrip({}, ""); }
+
+TEST(FlatbufferStringVectorTest, strings_of_all_alignments) {
+  checkRoundTrip({"", "a", "ab", "abc", "abcd", "abcde", "", "xyz"}, "");
+}
+
+TEST(FlatbufferStringVectorTest, strings_after_unaligned_data) {
+  for (std::string Before : {"1", "12", "123", "1234"}) {
+    checkRoundTrip({"first", "", "third string", "4"}, Before);
+  }
+}
+
+TEST(FlatbufferStringVectorTest, strings_containing_zeros) {
+  checkRoundTrip({std::string("a\0b", 3), std::string(100, 'x')}, "");
+}
@@ -0,0 +1,34 @@
+#include "../EpicsClient/LoadGenerator.h"
+#include <gtest/gtest.h>
+
+using namespace Forwarder::EpicsClient;
+
+TEST(LoadGeneratorTest, parse_scalar_group) {
+  auto Group = parseLoadGeneratorGroup("double,100,0,10");
+  ASSERT_EQ("double", Group.Type);
+  ASSERT_EQ(100u, Group.Count);
+  ASSERT_EQ(0u, Group.ArraySize);
+  ASSERT_EQ(std::chrono::milliseconds(10), Group.Period);
+}
+
+TEST(LoadGeneratorTest, parse_array_group) {
+  auto Group = parseLoadGeneratorGroup("ushort,4,100000,100");
+  ASSERT_EQ("ushort", Group.Type);
+  ASSERT_EQ(4u, Group.Count);
+  ASSERT_EQ(100000u, Group.ArraySize);
+  ASSERT_EQ(std::chrono::milliseconds(100), Group.Period);
+}
+
+TEST(LoadGeneratorTest, invalid_groups_throw) {
+  ASSERT_THROW(parseLoadGeneratorGroup(""), std::runtime_error);
+  ASSERT_THROW(parseLoadGeneratorGroup("double,1,0"), std::runtime_error);
+  ASSERT_THROW(parseLoadGeneratorGroup("quad,1,0,10"), std::runtime_error);
+  ASSERT_THROW(parseLoadGeneratorGroup("double,x,0,10"), std::runtime_error);
+  ASSERT_THROW(parseLoadGeneratorGroup("double,0,0,10"), std::runtime_error);
+  ASSERT_THROW(parseLoadGeneratorGroup("double,1,0,0"), std::runtime_error);
+}
+
+TEST(LoadGeneratorTest, channel_names_contain_group_and_index) {
+  LoadGenerator Generator("Test:", {});
+  ASSERT_EQ("Test:2:17", Generator.channelName(2, 17));
+}
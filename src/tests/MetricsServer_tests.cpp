@@ -0,0 +1,50 @@
+#include "MetricsServer.h"
+#include <gtest/gtest.h>
+#ifndef _MSC_VER
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace Forwarder;
+
+#ifndef _MSC_VER
+static std::string scrape(uint16_t Port) {
+  auto Socket = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in Address{};
+  Address.sin_family = AF_INET;
+  Address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  Address.sin_port = htons(Port);
+  std::string Response;
+  if (connect(Socket, reinterpret_cast<sockaddr *>(&Address),
+              sizeof(Address)) == 0) {
+    std::string Request = "GET /metrics HTTP/1.0\r\n\r\n";
+    send(Socket, Request.data(), Request.size(), 0);
+    char Buffer[1024];
+    ssize_t n;
+    while ((n = recv(Socket, Buffer, sizeof(Buffer), 0)) > 0) {
+      Response.append(Buffer, n);
+    }
+  }
+  close(Socket);
+  return Response;
+}
+
+TEST(MetricsServerTest, serves_the_latest_snapshot) {
+  MetricsServer Server(0);
+  ASSERT_EQ(0, Server.start());
+  ASSERT_NE(0, Server.port());
+  Server.setSnapshot("forwarder_streams 1\n");
+  Server.setSnapshot("forwarder_streams 2\n");
+  auto Response = scrape(Server.port());
+  ASSERT_EQ(0u, Response.find("HTTP/1.0 200 OK"));
+  ASSERT_NE(std::string::npos, Response.find("\r\n\r\nforwarder_streams 2\n"));
+  Server.stop();
+}
+#endif
+
+TEST(MetricsServerTest, label_values_are_escaped) {
+  ASSERT_EQ("a\\\"b\\\\c\\n", MetricsServer::escapeLabelValue("a\"b\\c\n"));
+  ASSERT_EQ("SIM:Spd", MetricsServer::escapeLabelValue("SIM:Spd"));
+}
@@ -0,0 +1,129 @@
+#include "../Kafka.h"
+#include "../KafkaOutput.h"
+#include "../KafkaW/MockProducer.h"
+#include <gtest/gtest.h>
+
+using namespace KafkaW;
+
+namespace {
+
+/// Counts the delivery callbacks of the messages which it is attached to.
+class CountingObserver : public FlatBufs::DeliveryObserver {
+public:
+  void deliveryOk() override { ++Ok; }
+  void deliveryFailed() override { ++Failed; }
+  int Ok = 0;
+  int Failed = 0;
+};
+
+std::shared_ptr<MockProducer> createProducer() {
+  BrokerSettings Settings;
+  Settings.Address = "mock:9092";
+  auto Producer = std::make_shared<MockProducer>(Settings);
+  Producer->on_delivery_ok = [](rd_kafka_message_t const *Message) {
+    delete static_cast<KafkaW::Producer::Msg *>(Message->_private);
+  };
+  Producer->on_delivery_failed = Producer->on_delivery_ok;
+  return Producer;
+}
+
+int produceString(ProducerTopic &Topic, std::string Payload) {
+  return Topic.produce(
+      reinterpret_cast<uchar *>(const_cast<char *>(Payload.data())),
+      Payload.size());
+}
+}
+
+TEST(MockProducerTest, produced_messages_are_recorded_and_delivered) {
+  auto Producer = createProducer();
+  ProducerTopic Topic(Producer, "some-topic");
+  ASSERT_EQ(0, produceString(Topic, "first"));
+  ASSERT_EQ(0, produceString(Topic, "second"));
+  auto Produced = Producer->produced();
+  ASSERT_EQ(2u, Produced.size());
+  ASSERT_EQ("some-topic", Produced[0].Topic);
+  ASSERT_EQ("second", std::string(Produced[1].Payload.begin(),
+                                  Produced[1].Payload.end()));
+  ASSERT_EQ(2u, Producer->Stats.produced);
+  ASSERT_EQ(11u, Producer->Stats.produced_bytes);
+  ASSERT_EQ(2u, Producer->outputQueueLength());
+  Producer->poll();
+  ASSERT_EQ(0u, Producer->outputQueueLength());
+  ASSERT_EQ(2u, Producer->Stats.produce_cb);
+}
+
+TEST(MockProducerTest, produce_fails_with_queue_full_at_capacity) {
+  auto Producer = createProducer();
+  Producer->QueueCapacity = 2;
+  ProducerTopic Topic(Producer, "some-topic");
+  ASSERT_EQ(0, produceString(Topic, "1"));
+  ASSERT_EQ(0, produceString(Topic, "2"));
+  ASSERT_NE(0, produceString(Topic, "3"));
+  ASSERT_EQ(1u, Producer->Stats.local_queue_full);
+  Producer->poll();
+  ASSERT_EQ(0, produceString(Topic, "3"));
+  ASSERT_EQ(3u, Producer->produced().size());
+}
+
+TEST(MockProducerTest, forced_produce_error_is_counted) {
+  auto Producer = createProducer();
+  Producer->ProduceError = RD_KAFKA_RESP_ERR_MSG_SIZE_TOO_LARGE;
+  ProducerTopic Topic(Producer, "some-topic");
+  ASSERT_NE(0, produceString(Topic, "too large"));
+  ASSERT_EQ(1u, Producer->Stats.msg_too_large);
+  ASSERT_EQ(0u, Producer->Stats.produced);
+  ASSERT_EQ(0u, Producer->outputQueueLength());
+}
+
+TEST(MockProducerTest, every_nth_delivery_fails) {
+  auto Producer = createProducer();
+  Producer->FailEveryNth = 3;
+  ProducerTopic Topic(Producer, "some-topic");
+  for (int i = 0; i < 9; ++i) {
+    ASSERT_EQ(0, produceString(Topic, "x"));
+  }
+  Producer->poll();
+  ASSERT_EQ(6u, Producer->Stats.produce_cb);
+  ASSERT_EQ(3u, Producer->Stats.produce_cb_fail);
+}
+
+TEST(MockProducerTest, delivery_waits_for_the_latency_unless_flushed) {
+  auto Producer = createProducer();
+  Producer->Latency = std::chrono::seconds(60);
+  ProducerTopic Topic(Producer, "some-topic");
+  ASSERT_EQ(0, produceString(Topic, "x"));
+  Producer->poll();
+  ASSERT_EQ(1u, Producer->outputQueueLength());
+  ASSERT_EQ(0u, Producer->Stats.produce_cb);
+  Producer->flush();
+  ASSERT_EQ(0u, Producer->outputQueueLength());
+  ASSERT_EQ(1u, Producer->Stats.produce_cb);
+}
+
+TEST(MockProducerTest, instance_set_uses_the_producer_factory) {
+  std::shared_ptr<MockProducer> Producer;
+  Forwarder::InstanceSet::setProducerFactory(
+      [&Producer](BrokerSettings Settings) {
+        Producer = std::make_shared<MockProducer>(Settings);
+        return Producer;
+      });
+  Forwarder::InstanceSet::clear();
+  auto Set = Forwarder::InstanceSet::Set(BrokerSettings());
+  Forwarder::KafkaOutput Output(
+      Set->producer_topic(Forwarder::URI("//mock:9092/the-topic")));
+  ASSERT_TRUE(Producer);
+  auto Observer = std::make_shared<CountingObserver>();
+  auto Payload = std::make_shared<std::vector<uint8_t> const>(
+      std::vector<uint8_t>{1, 2, 3});
+  FlatBufs::FlatbufferMessage::uptr Message(
+      new FlatBufs::FlatbufferMessage(Payload));
+  Message->Observer = Observer;
+  ASSERT_EQ(0, Output.emit(std::move(Message)));
+  Set->poll();
+  ASSERT_EQ(1, Observer->Ok);
+  ASSERT_EQ(0, Observer->Failed);
+  ASSERT_EQ("the-topic", Producer->produced().at(0).Topic);
+  ASSERT_EQ(*Payload, Producer->produced().at(0).Payload);
+  Forwarder::InstanceSet::clear();
+  Forwarder::InstanceSet::setProducerFactory(nullptr);
+}
@@ -0,0 +1,79 @@
+#include "RangeSet.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+using Ranges = std::vector<std::pair<uint64_t, uint64_t>>;
+
+static Ranges toPairs(RangeSet<uint64_t> &Set) {
+  Ranges Pairs;
+  for (auto const &R : Set.ranges()) {
+    Pairs.emplace_back(R.a, R.b);
+  }
+  return Pairs;
+}
+
+TEST(RangeSetTest, empty_set_has_no_max) {
+  RangeSet<uint64_t> Set;
+  uint64_t Max = 0;
+  ASSERT_FALSE(Set.max(Max));
+  ASSERT_EQ(0u, Set.size());
+}
+
+TEST(RangeSetTest, in_order_inserts_form_one_range) {
+  RangeSet<uint64_t> Set;
+  for (uint64_t i = 0; i < 1000; ++i) {
+    Set.insert(i);
+  }
+  ASSERT_EQ((Ranges{{0, 999}}), toPairs(Set));
+  uint64_t Max = 0;
+  ASSERT_TRUE(Set.max(Max));
+  ASSERT_EQ(999u, Max);
+}
+
+TEST(RangeSetTest, gaps_are_kept_and_filled) {
+  RangeSet<uint64_t> Set;
+  for (uint64_t k : {1, 2, 5, 6, 10, 3, 12}) {
+    Set.insert(k);
+  }
+  ASSERT_EQ((Ranges{{1, 3}, {5, 6}, {10, 10}, {12, 12}}), toPairs(Set));
+  Set.insert(4);
+  Set.insert(11);
+  ASSERT_EQ((Ranges{{1, 6}, {10, 12}}), toPairs(Set));
+  Set.insert(9);
+  Set.insert(8);
+  Set.insert(7);
+  ASSERT_EQ((Ranges{{1, 12}}), toPairs(Set));
+}
+
+TEST(RangeSetTest, duplicates_are_ignored) {
+  RangeSet<uint64_t> Set;
+  for (uint64_t k : {5, 3, 5, 3, 4, 4, 8, 8}) {
+    Set.insert(k);
+  }
+  ASSERT_EQ((Ranges{{3, 5}, {8, 8}}), toPairs(Set));
+}
+
+TEST(RangeSetTest, inserts_below_the_lowest_range) {
+  RangeSet<uint64_t> Set;
+  for (uint64_t k : {10, 0, 8, 9, 1}) {
+    Set.insert(k);
+  }
+  ASSERT_EQ((Ranges{{0, 1}, {8, 10}}), toPairs(Set));
+}
+
+TEST(RangeSetTest, concurrent_inserts_cover_all_values) {
+  RangeSet<uint64_t> Set;
+  uint64_t const N = 100000;
+  std::vector<std::thread> Threads;
+  for (uint64_t t = 0; t < 4; ++t) {
+    Threads.emplace_back([&Set, t, N] {
+      for (uint64_t i = t; i < N; i += 4) {
+        Set.insert(i);
+      }
+    });
+  }
+  for (auto &Thread : Threads) {
+    Thread.join();
+  }
+  ASSERT_EQ((Ranges{{0, N - 1}}), toPairs(Set));
+}
@@ -0,0 +1,64 @@
+#include "SequenceLossDetector.h"
+#include <gtest/gtest.h>
+
+using namespace Forwarder;
+
+TEST(SequenceLossDetectorTest, consecutive_sequence_has_no_loss) {
+  SequenceLossDetector Detector;
+  for (uint64_t i = 0; i < 100; ++i) {
+    Detector.next(i);
+  }
+  ASSERT_EQ(0u, Detector.missing());
+  ASSERT_EQ(0u, Detector.repeated());
+  ASSERT_EQ(0u, Detector.restarts());
+}
+
+TEST(SequenceLossDetectorTest, sequence_may_start_anywhere) {
+  SequenceLossDetector Detector;
+  Detector.next(42);
+  Detector.next(43);
+  ASSERT_EQ(0u, Detector.missing());
+}
+
+TEST(SequenceLossDetectorTest, gaps_are_counted_as_missing) {
+  SequenceLossDetector Detector;
+  for (uint64_t i : {0, 1, 3, 4, 8}) {
+    Detector.next(i);
+  }
+  ASSERT_EQ(4u, Detector.missing());
+}
+
+TEST(SequenceLossDetectorTest, repeats_and_restarts_are_not_missing) {
+  SequenceLossDetector Detector;
+  for (uint64_t i : {0, 1, 2, 2, 1}) {
+    Detector.next(i);
+  }
+  Detector.restart(0);
+  Detector.next(1);
+  Detector.next(2);
+  ASSERT_EQ(0u, Detector.missing());
+  ASSERT_EQ(2u, Detector.repeated());
+  ASSERT_EQ(1u, Detector.restarts());
+}
+
+TEST(SequenceLossDetectorTest, restart_after_an_overrun_is_not_missing) {
+  SequenceLossDetector Detector;
+  for (uint64_t i : {0, 1, 2, 3}) {
+    Detector.next(i);
+  }
+  // The first update after a reconnect had an overrun.
+  Detector.restart(1);
+  Detector.next(2);
+  ASSERT_EQ(0u, Detector.missing());
+  ASSERT_EQ(0u, Detector.repeated());
+  ASSERT_EQ(1u, Detector.restarts());
+}
+
+TEST(SequenceLossDetectorTest, zero_without_restart_is_repeated) {
+  SequenceLossDetector Detector;
+  for (uint64_t i : {0, 1, 2, 0}) {
+    Detector.next(i);
+  }
+  ASSERT_EQ(1u, Detector.repeated());
+  ASSERT_EQ(0u, Detector.restarts());
+}
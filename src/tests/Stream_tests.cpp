@@ -0,0 +1,155 @@
+#include "../Converter.h"
+#include "../EpicsPVUpdate.h"
+#include "../KafkaOutput.h"
+#include "../KafkaW/MockProducer.h"
+#include "../MainOpt.h"
+#include "../Stream.h"
+#include "../helper.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+
+using namespace Forwarder;
+
+namespace {
+
+/// What the converters of the test schema were asked to do.
+struct ConverterCalls {
+  /// The initial builder sizes which the converters were given.
+  std::vector<uint32_t> InitialSizes;
+  /// The size of the vector in the next message.
+  size_t PayloadSize = 16;
+};
+
+ConverterCalls Calls;
+
+/// Writes a vector of Calls.PayloadSize bytes into a message created with the
+/// given initial size.
+class CountingConverter : public FlatBufs::MakeFlatBufferFromPVStructure {
+public:
+  FlatBufs::FlatbufferMessage::uptr
+  convert(FlatBufs::EpicsPVUpdate const &Update) override {
+    return convertWithSizeHint(Update, 0);
+  }
+  FlatBufs::FlatbufferMessage::uptr
+  convertWithSizeHint(FlatBufs::EpicsPVUpdate const &Update,
+                      uint32_t InitialSize) override {
+    Calls.InitialSizes.push_back(InitialSize);
+    auto Message = FlatBufs::FlatbufferMessage::create(InitialSize);
+    std::vector<uint8_t> Payload(Calls.PayloadSize,
+                                 static_cast<uint8_t>(Update.seq_data));
+    Message->builder->Finish(Message->builder->CreateVector(Payload));
+    return Message;
+  }
+};
+
+class CountingInfo : public FlatBufs::SchemaInfo {
+public:
+  FlatBufs::MakeFlatBufferFromPVStructure::ptr create_converter() override {
+    return ::make_unique<CountingConverter>();
+  }
+};
+
+FlatBufs::SchemaRegistry::Registrar<CountingInfo>
+    g_registrar_counting("test-counting", ::make_unique<CountingInfo>());
+
+class ConversionPathTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    Calls = ConverterCalls();
+    KafkaW::BrokerSettings Settings;
+    Settings.Address = "mock:9092";
+    Producer = std::make_shared<KafkaW::MockProducer>(Settings);
+    Producer->on_delivery_ok = [](rd_kafka_message_t const *Message) {
+      delete static_cast<KafkaW::Producer::Msg *>(Message->_private);
+    };
+    Producer->on_delivery_failed = Producer->on_delivery_ok;
+    Statistics = std::make_shared<StreamStatistics>();
+    Path = ::make_unique<ConversionPath>(
+        Converter::create(FlatBufs::SchemaRegistry(), "test-counting",
+                          MainOpt()),
+        ::make_unique<KafkaOutput>(
+            KafkaW::Producer::Topic(Producer, "some-topic")),
+        Statistics);
+  }
+
+  std::shared_ptr<FlatBufs::EpicsPVUpdate> createUpdate(uint64_t Sequence) {
+    auto Update = std::make_shared<FlatBufs::EpicsPVUpdate>();
+    Update->channel = "some-channel";
+    Update->seq_data = Sequence;
+    return Update;
+  }
+
+  std::shared_ptr<KafkaW::MockProducer> Producer;
+  std::shared_ptr<StreamStatistics> Statistics;
+  std::unique_ptr<ConversionPath> Path;
+};
+}
+
+TEST_F(ConversionPathTest, repeated_update_is_converted_once) {
+  // Only repeats fill the cache, so a new value is converted on arrival and
+  // once more on its first repeat.
+  auto Update = createUpdate(1);
+  Update->Repeated = true;
+  ASSERT_EQ(0, Path->emit(Update));
+  ASSERT_EQ(0, Path->emit(Update));
+  ASSERT_EQ(1u, Calls.InitialSizes.size());
+  ASSERT_EQ(1u, Statistics->UpdatesRepeated.load());
+  auto Produced = Producer->produced();
+  ASSERT_EQ(2u, Produced.size());
+  ASSERT_EQ(Produced[0].Payload, Produced[1].Payload);
+
+  auto Other = createUpdate(2);
+  Other->Repeated = true;
+  ASSERT_EQ(0, Path->emit(Other));
+  ASSERT_EQ(2u, Calls.InitialSizes.size());
+  ASSERT_EQ(1u, Statistics->UpdatesRepeated.load());
+  Produced = Producer->produced();
+  ASSERT_EQ(3u, Produced.size());
+  ASSERT_NE(Produced[0].Payload, Produced[2].Payload);
+  ASSERT_EQ(3u, Statistics->UpdatesProduced.load());
+}
+
+TEST_F(ConversionPathTest, update_which_is_not_repeated_is_always_converted) {
+  auto Update = createUpdate(1);
+  ASSERT_EQ(0, Path->emit(Update));
+  ASSERT_EQ(0, Path->emit(Update));
+  ASSERT_EQ(2u, Calls.InitialSizes.size());
+  ASSERT_EQ(0u, Statistics->UpdatesRepeated.load());
+}
+
+TEST_F(ConversionPathTest, builder_size_follows_the_average_message_size) {
+  Calls.PayloadSize = 16;
+  ASSERT_EQ(0, Path->emit(createUpdate(1)));
+  // Nothing to estimate from yet, the converter uses the default size.
+  ASSERT_EQ(0u, Calls.InitialSizes[0]);
+  uint32_t First = Producer->produced()[0].Payload.size();
+  ASSERT_EQ(First, Path->status_json()["average_message_size"].get<uint32_t>());
+
+  Calls.PayloadSize = 1000;
+  ASSERT_EQ(0, Path->emit(createUpdate(2)));
+  ASSERT_EQ(First + First / 8 + 64, Calls.InitialSizes[1]);
+  uint32_t Second = Producer->produced()[1].Payload.size();
+  uint32_t Average = First + (Second - First) / 8;
+  ASSERT_EQ(Average,
+            Path->status_json()["average_message_size"].get<uint32_t>());
+
+  ASSERT_EQ(0, Path->emit(createUpdate(3)));
+  ASSERT_EQ(Average + Average / 8 + 64, Calls.InitialSizes[2]);
+  Average += (Second - Average) / 8;
+  ASSERT_EQ(Average,
+            Path->status_json()["average_message_size"].get<uint32_t>());
+}
+
+TEST(FlatbufferMessageTest, initial_size_does_not_change_the_message) {
+  auto Serialize = [](uint32_t InitialSize) {
+    auto Message = FlatBufs::FlatbufferMessage::create(InitialSize);
+    EXPECT_TRUE(Message->builder != nullptr);
+    Message->builder->Finish(
+        Message->builder->CreateString("some-channel-name"));
+    auto Slice = Message->message();
+    return std::vector<uint8_t>(Slice.data, Slice.data + Slice.size);
+  };
+  ASSERT_EQ(Serialize(0), Serialize(16));
+  ASSERT_EQ(Serialize(0), Serialize(100000));
+}
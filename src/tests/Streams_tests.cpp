@@ -15,6 +15,8 @@ public:
   int stop() override { return 0; };
   void errorInEpics() override { status_ = -1; };
   int status() override { return status_; };
+  bool connected() override { return Connected; };
+  bool Connected{true};
 
 private:
   int status_{0};
@@ -158,7 +160,7 @@ TEST(StreamsTest, channel_stop_removes_all_channels_with_matched_channel_name) {
 
   streams.add(s);
   streams.add(s2);
-  streams.channel_stop("world");
+  ASSERT_EQ(2u, streams.channel_stop("world"));
   ASSERT_EQ(nullptr, streams.back().get());
   ASSERT_EQ(streams.size(), 0u);
 }
@@ -170,7 +172,7 @@ TEST(StreamsTest,
   auto s2 = createStream("world", "world");
   streams.add(s);
   streams.add(s2);
-  streams.channel_stop("nothelloworld");
+  ASSERT_EQ(0u, streams.channel_stop("nothelloworld"));
   ASSERT_EQ(s2.get(), streams.back().get());
   ASSERT_EQ(streams.size(), 2u);
 }
@@ -186,3 +188,130 @@ TEST(StreamsTest,
   ASSERT_EQ(s2.get(), streams.back().get());
   ASSERT_EQ(streams.size(), 2u);
 }
+
+TEST(StreamsTest, rates_are_zero_before_two_updates) {
+  Streams streams;
+  auto s = createStream("hello", "world");
+  streams.add(s);
+  s->statistics().BytesProduced += 1000;
+  streams.update_rates(std::chrono::steady_clock::now());
+  ASSERT_EQ(0.0, s->statistics().BytesPerSecond.load());
+}
+
+TEST(StreamsTest, rates_follow_produced_bytes) {
+  Streams streams;
+  auto s = createStream("hello", "world");
+  streams.add(s);
+  auto Now = std::chrono::steady_clock::now();
+  streams.update_rates(Now);
+  for (int i = 1; i <= 100; ++i) {
+    s->statistics().BytesProduced += 1000;
+    s->statistics().UpdatesProduced += 10;
+    streams.update_rates(Now + std::chrono::seconds(i));
+  }
+  ASSERT_NEAR(1000.0, s->statistics().BytesPerSecond.load(), 1.0);
+  ASSERT_NEAR(10.0, s->statistics().UpdatesPerSecond.load(), 0.01);
+}
+
+TEST(StreamsTest, hottest_returns_streams_ordered_by_byte_rate) {
+  Streams streams;
+  auto s1 = createStream("hello", "cold");
+  auto s2 = createStream("hello", "hot");
+  auto s3 = createStream("hello", "warm");
+  streams.add(s1);
+  streams.add(s2);
+  streams.add(s3);
+  s1->statistics().BytesPerSecond = 1;
+  s2->statistics().BytesPerSecond = 100;
+  s3->statistics().BytesPerSecond = 10;
+  auto Hottest = streams.hottest(2);
+  ASSERT_EQ(2u, Hottest.size());
+  ASSERT_EQ(s2.get(), Hottest[0].get());
+  ASSERT_EQ(s3.get(), Hottest[1].get());
+  ASSERT_EQ(3u, streams.hottest(10).size());
+}
+
+TEST(StreamsTest, connected_count_counts_connected_channels) {
+  Streams streams;
+  auto ring = std::make_shared<
+      moodycamel::ConcurrentQueue<std::shared_ptr<FlatBufs::EpicsPVUpdate>>>();
+  auto client = std::make_shared<FakeEpicsClient>();
+  client->Connected = false;
+  ChannelInfo ci{"hello", "disconnected"};
+  streams.add(std::make_shared<Stream>(ci, client, ring));
+  streams.add(createStream("hello", "connected"));
+  ASSERT_EQ(1u, streams.connected_count());
+  client->Connected = true;
+  ASSERT_EQ(2u, streams.connected_count());
+}
+
+TEST(StreamsTest, stopped_streams_are_retired_until_grace_period_passed) {
+  Streams streams;
+  auto s = createStream("hello", "world");
+  std::weak_ptr<Stream> Weak = s;
+  streams.add(s);
+  s.reset();
+  auto Now = std::chrono::steady_clock::now();
+  streams.channel_stop("world");
+  ASSERT_EQ(0u, streams.size());
+  ASSERT_EQ(1u, streams.retired_count());
+  ASSERT_EQ(1u, streams.reclaim(Now));
+  ASSERT_FALSE(Weak.expired());
+  ASSERT_EQ(0u, streams.reclaim(Now + Streams::RetireGracePeriod +
+                                std::chrono::milliseconds(1)));
+  ASSERT_TRUE(Weak.expired());
+}
+
+TEST(StreamsTest, clear_retires_all_streams) {
+  Streams streams;
+  streams.add(createStream("hello", "world"));
+  streams.add(createStream("world", "hello"));
+  streams.streams_clear();
+  ASSERT_EQ(0u, streams.size());
+  ASSERT_EQ(2u, streams.retired_count());
+  streams.drain_retired(std::chrono::milliseconds(5000));
+  ASSERT_EQ(0u, streams.retired_count());
+}
+
+TEST(StreamsTest, streams_can_be_found_by_channel_and_id) {
+  Streams streams;
+  auto ID = streams.add(createStream("hello", "world"));
+  streams.add(createStream("world", "hello"));
+  streams.add(createStream("other", "world"));
+  ASSERT_EQ(2u, streams.find("world").size());
+  ASSERT_EQ(1u, streams.find("hello").size());
+  ASSERT_EQ(0u, streams.find("missing").size());
+  ASSERT_EQ("hello", streams.find(ID)->channel_info().provider_type);
+  streams.channel_stop("world");
+  ASSERT_EQ(nullptr, streams.find(ID));
+  ASSERT_EQ(0u, streams.find("world").size());
+  ASSERT_EQ("hello", streams[0]->channel_info().channel_name);
+}
+
+TEST(StreamsTest, snapshot_is_not_affected_by_later_changes) {
+  Streams streams;
+  streams.add(createStream("hello", "world"));
+  auto Before = streams.snapshot();
+  ASSERT_EQ(Before, streams.snapshot());
+  streams.add(std::vector<std::shared_ptr<Stream>>{
+      createStream("hello", "a"), createStream("hello", "b")});
+  streams.channel_stop("world");
+  ASSERT_EQ(1u, Before->size());
+  ASSERT_EQ("world", (*Before)[0]->channel_info().channel_name);
+  auto After = streams.snapshot();
+  ASSERT_EQ(2u, After->size());
+  ASSERT_EQ("a", (*After)[0]->channel_info().channel_name);
+  ASSERT_EQ("b", (*After)[1]->channel_info().channel_name);
+}
+
+TEST(StreamsTest, retired_stream_is_kept_while_a_snapshot_refers_to_it) {
+  Streams streams;
+  streams.add(createStream("hello", "world"));
+  auto Snapshot = streams.snapshot();
+  streams.channel_stop("world");
+  auto Later = std::chrono::steady_clock::now() + Streams::RetireGracePeriod +
+               std::chrono::milliseconds(1);
+  ASSERT_EQ(1u, streams.reclaim(Later));
+  Snapshot.reset();
+  ASSERT_EQ(0u, streams.reclaim(Later));
+}
@@ -0,0 +1,86 @@
+#include "../TimingWheel.h"
+#include <gtest/gtest.h>
+#include <set>
+
+using namespace Forwarder;
+using std::chrono::milliseconds;
+
+TEST(TimingWheelTest, callback_is_called_once_per_period) {
+  auto Start = TimingWheel::Clock::now();
+  TimingWheel Wheel(milliseconds(10), 16, Start);
+  int Called = 0;
+  Wheel.add(milliseconds(100), [&Called]() {
+    ++Called;
+    return true;
+  });
+  // Spans more than one round of the wheel.
+  for (int i = 1; i <= 100; ++i) {
+    Wheel.advance(Start + milliseconds(10 * i));
+    Wheel.runDue(10);
+  }
+  ASSERT_EQ(10, Called);
+}
+
+TEST(TimingWheelTest, callbacks_with_same_period_are_spread_over_ticks) {
+  auto Start = TimingWheel::Clock::now();
+  TimingWheel Wheel(milliseconds(10), 128, Start);
+  std::set<int> Ticks;
+  int Tick = 0;
+  for (int i = 0; i < 50; ++i) {
+    Wheel.add(milliseconds(1000), [&Ticks, &Tick]() {
+      Ticks.insert(Tick);
+      return true;
+    });
+  }
+  for (Tick = 1; Tick <= 100; ++Tick) {
+    Wheel.advance(Start + milliseconds(10 * Tick));
+    Wheel.runDue(100);
+  }
+  ASSERT_GT(Ticks.size(), 10u);
+}
+
+TEST(TimingWheelTest, callback_returning_false_is_removed) {
+  auto Start = TimingWheel::Clock::now();
+  TimingWheel Wheel(milliseconds(10), 16, Start);
+  int Called = 0;
+  Wheel.add(milliseconds(10), [&Called]() {
+    ++Called;
+    return false;
+  });
+  ASSERT_EQ(1u, Wheel.size());
+  for (int i = 1; i <= 10; ++i) {
+    Wheel.advance(Start + milliseconds(10 * i));
+    Wheel.runDue(10);
+  }
+  ASSERT_EQ(1, Called);
+  ASSERT_EQ(0u, Wheel.size());
+}
+
+TEST(TimingWheelTest, pending_callback_is_not_queued_twice) {
+  auto Start = TimingWheel::Clock::now();
+  TimingWheel Wheel(milliseconds(10), 16, Start);
+  int Called = 0;
+  Wheel.add(milliseconds(10), [&Called]() {
+    ++Called;
+    return true;
+  });
+  ASSERT_EQ(1u, Wheel.advance(Start + milliseconds(10)));
+  ASSERT_EQ(0u, Wheel.advance(Start + milliseconds(20)));
+  ASSERT_EQ(1u, Wheel.overruns());
+  ASSERT_EQ(1u, Wheel.runDue(10));
+  ASSERT_EQ(1, Called);
+}
+
+TEST(TimingWheelTest, missed_periods_are_skipped) {
+  auto Start = TimingWheel::Clock::now();
+  TimingWheel Wheel(milliseconds(10), 16, Start);
+  int Called = 0;
+  Wheel.add(milliseconds(10), [&Called]() {
+    ++Called;
+    return true;
+  });
+  ASSERT_EQ(1u, Wheel.advance(Start + milliseconds(1000)));
+  ASSERT_EQ(1u, Wheel.runDue(10));
+  ASSERT_EQ(0u, Wheel.overruns());
+  ASSERT_EQ(1u, Wheel.advance(Start + milliseconds(1010)));
+}
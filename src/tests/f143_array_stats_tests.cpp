@@ -0,0 +1,105 @@
+#include "../EpicsPVUpdate.h"
+#include "../SchemaRegistry.h"
+#include "schemas/f143_structure_generated.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <memory>
+#include <pv/pvData.h>
+#include <pv/standardPVField.h>
+#include <string>
+#include <vector>
+
+namespace pvd = epics::pvData;
+using namespace f143_structure;
+
+namespace {
+
+FlatBufs::MakeFlatBufferFromPVStructure::ptr createConverter() {
+  return FlatBufs::SchemaRegistry::items()
+      .at("f143-array-stats")
+      ->create_converter();
+}
+
+std::shared_ptr<FlatBufs::EpicsPVUpdate>
+createUpdate(pvd::PVStructurePtr Structure) {
+  auto Update = std::make_shared<FlatBufs::EpicsPVUpdate>();
+  Update->channel = "some-array";
+  Update->epics_pvstr = Structure;
+  return Update;
+}
+
+std::shared_ptr<FlatBufs::EpicsPVUpdate>
+createArrayUpdate(std::vector<int16_t> const &Values) {
+  auto Structure =
+      pvd::getStandardPVField()->scalarArray(pvd::pvShort, "timeStamp");
+  pvd::shared_vector<int16_t> Array(Values.size());
+  std::copy(Values.begin(), Values.end(), Array.begin());
+  Structure->getSubField<pvd::PVShortArray>("value")->replace(
+      pvd::freeze(Array));
+  return createUpdate(Structure);
+}
+
+/// The member of the summary with the given name, nullptr if missing.
+ObjM const *member(FlatBufs::FlatbufferMessage const &Message,
+                   std::string const &Name) {
+  auto Summary = GetStructure(Message.builder->GetBufferPointer());
+  for (auto Member : *Summary->value_as_Obj()->value()) {
+    if (Member->k()->str() == Name) {
+      return Member;
+    }
+  }
+  return nullptr;
+}
+}
+
+TEST(f143ArrayStatsTest, array_is_summarized) {
+  auto Converter = createConverter();
+  auto Message = Converter->convert(*createArrayUpdate({4, -2, 7, 3}));
+  ASSERT_TRUE(Message);
+  ASSERT_EQ("some-array",
+            GetStructure(Message->builder->GetBufferPointer())->name()->str());
+  ASSERT_EQ(4u, member(*Message, "count")->v_as_ULong()->value());
+  ASSERT_EQ(-2, member(*Message, "min")->v_as_Double()->value());
+  ASSERT_EQ(7, member(*Message, "max")->v_as_Double()->value());
+  ASSERT_EQ(12, member(*Message, "sum")->v_as_Double()->value());
+  ASSERT_EQ(3, member(*Message, "mean")->v_as_Double()->value());
+  ASSERT_EQ(nullptr, member(*Message, "decimated"));
+}
+
+TEST(f143ArrayStatsTest, decimated_array_holds_the_means_of_the_blocks) {
+  auto Converter = createConverter();
+  Converter->config({{"decimate", 2}}, {});
+  auto Message = Converter->convert(*createArrayUpdate({1, 3, 5, 7, 9, -1}));
+  ASSERT_TRUE(Message);
+  ASSERT_EQ(6u, member(*Message, "count")->v_as_ULong()->value());
+  ASSERT_EQ(-1, member(*Message, "min")->v_as_Double()->value());
+  ASSERT_EQ(9, member(*Message, "max")->v_as_Double()->value());
+  ASSERT_EQ(4, member(*Message, "mean")->v_as_Double()->value());
+  auto Decimated = member(*Message, "decimated")->v_as_ArrayDouble()->value();
+  ASSERT_EQ(2u, Decimated->size());
+  ASSERT_EQ(3, Decimated->Get(0));
+  ASSERT_EQ(5, Decimated->Get(1));
+}
+
+TEST(f143ArrayStatsTest, empty_array_is_summarized_as_zero) {
+  auto Converter = createConverter();
+  auto Message = Converter->convert(*createArrayUpdate({}));
+  ASSERT_TRUE(Message);
+  ASSERT_EQ(0u, member(*Message, "count")->v_as_ULong()->value());
+  ASSERT_EQ(0, member(*Message, "mean")->v_as_Double()->value());
+}
+
+TEST(f143ArrayStatsTest, scalar_is_not_an_array) {
+  auto Converter = createConverter();
+  auto Structure = pvd::getStandardPVField()->scalar(pvd::pvDouble, "");
+  ASSERT_FALSE(Converter->convert(*createUpdate(Structure)));
+}
+
+TEST(f143ArrayStatsTest, string_array_can_not_be_summarized) {
+  auto Converter = createConverter();
+  auto Structure = pvd::getStandardPVField()->scalarArray(pvd::pvString, "");
+  pvd::shared_vector<std::string> Array(2, "text");
+  Structure->getSubField<pvd::PVStringArray>("value")->replace(
+      pvd::freeze(Array));
+  ASSERT_FALSE(Converter->convert(*createUpdate(Structure)));
+}
@@ -0,0 +1,167 @@
+#include "../EpicsPVUpdate.h"
+#include "../SchemaRegistry.h"
+#include "schemas/f143_structure_generated.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <pv/pvData.h>
+#include <pv/standardPVField.h>
+#include <string>
+#include <vector>
+
+namespace pvd = epics::pvData;
+using namespace f143_structure;
+
+namespace {
+
+using V_t = std::pair<Value, flatbuffers::Offset<void>>;
+
+/// Serializes like the converter did before it cached plans: it walks the
+/// introspection interface of every update. Covers the field types of the
+/// structures in these tests, whose scalar arrays are of int.
+V_t referenceField(flatbuffers::FlatBufferBuilder &Builder,
+                   pvd::PVField const *Field) {
+  switch (Field->getField()->getType()) {
+  case pvd::structure: {
+    std::vector<std::string> Names;
+    std::vector<V_t> Values;
+    for (auto &Subfield :
+         static_cast<pvd::PVStructure const *>(Field)->getPVFields()) {
+      Names.push_back(Subfield->getFieldName());
+      Values.push_back(referenceField(Builder, Subfield.get()));
+    }
+    std::vector<flatbuffers::Offset<ObjM>> Members;
+    for (size_t i = 0; i < Values.size(); ++i) {
+      auto Name = Builder.CreateString(Names[i]);
+      ObjMBuilder b(Builder);
+      b.add_k(Name);
+      b.add_v_type(Values[i].first);
+      b.add_v(Values[i].second);
+      Members.push_back(b.Finish());
+    }
+    auto Vector = Builder.CreateVector(Members);
+    ObjBuilder b(Builder);
+    b.add_value(Vector);
+    return {Value::Obj, b.Finish().Union()};
+  }
+  case pvd::scalar: {
+    auto Scalar = static_cast<pvd::PVScalar const *>(Field);
+    switch (Scalar->getScalar()->getScalarType()) {
+    case pvd::pvInt: {
+      IntBuilder b(Builder);
+      b.add_value(Scalar->getAs<int32_t>());
+      return {Value::Int, b.Finish().Union()};
+    }
+    case pvd::pvLong: {
+      LongBuilder b(Builder);
+      b.add_value(Scalar->getAs<int64_t>());
+      return {Value::Long, b.Finish().Union()};
+    }
+    case pvd::pvDouble: {
+      DoubleBuilder b(Builder);
+      b.add_value(Scalar->getAs<double>());
+      return {Value::Double, b.Finish().Union()};
+    }
+    case pvd::pvString: {
+      auto String = Builder.CreateString(Scalar->getAs<std::string>());
+      StringBuilder b(Builder);
+      b.add_value(String);
+      return {Value::String, b.Finish().Union()};
+    }
+    default:
+      break;
+    }
+    break;
+  }
+  case pvd::scalarArray: {
+    auto View = static_cast<pvd::PVIntArray const *>(Field)->view();
+    auto Vector = Builder.CreateVector(View.data(), View.size());
+    ArrayIntBuilder b(Builder);
+    b.add_value(Vector);
+    return {Value::ArrayInt, b.Finish().Union()};
+  }
+  default:
+    break;
+  }
+  ADD_FAILURE() << "Field type not covered by the reference serializer";
+  return {Value::NONE, 0};
+}
+
+std::vector<uint8_t>
+referenceSerialize(FlatBufs::EpicsPVUpdate const &Update) {
+  flatbuffers::FlatBufferBuilder Builder;
+  auto Name = Builder.CreateString(Update.channel);
+  auto Root = referenceField(Builder, Update.epics_pvstr.get());
+  StructureBuilder b(Builder);
+  b.add_name(Name);
+  b.add_value_type(Root.first);
+  b.add_value(Root.second);
+  auto TimeStamp =
+      Update.epics_pvstr->getSubField<pvd::PVStructure>("timeStamp");
+  b.add_timestamp(
+      static_cast<uint64_t>(
+          TimeStamp->getSubField<pvd::PVLong>("secondsPastEpoch")->get()) *
+          1000000000 +
+      TimeStamp->getSubField<pvd::PVInt>("nanoseconds")->get());
+  b.add_fwdinfo_type(forwarder_internal::fwdinfo_1_t);
+  b.add_fwdinfo(0);
+  FinishStructureBuffer(Builder, b.Finish());
+  return {Builder.GetBufferPointer(),
+          Builder.GetBufferPointer() + Builder.GetSize()};
+}
+
+std::vector<uint8_t>
+serialize(FlatBufs::MakeFlatBufferFromPVStructure &Converter,
+          FlatBufs::EpicsPVUpdate const &Update) {
+  auto Message = Converter.convert(Update);
+  auto Slice = Message->message();
+  return {Slice.data, Slice.data + Slice.size};
+}
+
+std::shared_ptr<FlatBufs::EpicsPVUpdate>
+createUpdate(pvd::PVStructurePtr Structure) {
+  auto Update = std::make_shared<FlatBufs::EpicsPVUpdate>();
+  Update->channel = "some-structure";
+  Update->epics_pvstr = Structure;
+  auto TimeStamp = Structure->getSubField<pvd::PVStructure>("timeStamp");
+  TimeStamp->getSubField<pvd::PVLong>("secondsPastEpoch")->put(1234);
+  TimeStamp->getSubField<pvd::PVInt>("nanoseconds")->put(5678);
+  return Update;
+}
+}
+
+TEST(f143Test, cached_plan_gives_the_same_output_as_before) {
+  auto Converter =
+      FlatBufs::SchemaRegistry::items().at("f143")->create_converter();
+  auto Structure =
+      pvd::getStandardPVField()->scalar(pvd::pvDouble, "alarm,timeStamp");
+  auto Update = createUpdate(Structure);
+  Structure->getSubField<pvd::PVDouble>("value")->put(1.5);
+  Structure->getSubField<pvd::PVString>("alarm.message")->put("first");
+  ASSERT_EQ(referenceSerialize(*Update), serialize(*Converter, *Update));
+
+  // The same introspection interface again, now serialized with the cached
+  // plan.
+  Structure->getSubField<pvd::PVDouble>("value")->put(-2.5);
+  Structure->getSubField<pvd::PVString>("alarm.message")->put("second");
+  Structure->getSubField<pvd::PVInt>("alarm.severity")->put(2);
+  ASSERT_EQ(referenceSerialize(*Update), serialize(*Converter, *Update));
+}
+
+TEST(f143Test, changed_structure_is_serialized_with_a_new_plan) {
+  auto Converter =
+      FlatBufs::SchemaRegistry::items().at("f143")->create_converter();
+  auto First = createUpdate(
+      pvd::getStandardPVField()->scalar(pvd::pvDouble, "alarm,timeStamp"));
+  ASSERT_EQ(referenceSerialize(*First), serialize(*Converter, *First));
+
+  // The channel changed its type, the plan of the old structure must not be
+  // applied.
+  auto Structure =
+      pvd::getStandardPVField()->scalarArray(pvd::pvInt, "alarm,timeStamp");
+  pvd::shared_vector<int32_t> Array(3, 7);
+  Structure->getSubField<pvd::PVIntArray>("value")->replace(
+      pvd::freeze(Array));
+  auto Second = createUpdate(Structure);
+  ASSERT_EQ(referenceSerialize(*Second), serialize(*Converter, *Second));
+  ASSERT_EQ(referenceSerialize(*First), serialize(*Converter, *First));
+}
@@ -0,0 +1,110 @@
+#include "../LoggerImpl.h"
+#include "logger.h"
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST(LoggerTest, arguments_above_compiled_level_are_not_evaluated) {
+  int Evaluated = 0;
+  auto Count = [&Evaluated]() { return ++Evaluated; };
+  LOG(LOG_LEVEL_COMPILED + 1, "{}", Count());
+  ASSERT_EQ(0, Evaluated);
+}
+
+TEST(LoggerTest, arguments_above_runtime_level_are_not_evaluated) {
+  int Evaluated = 0;
+  auto Count = [&Evaluated]() { return ++Evaluated; };
+  LOG(log_level + 1, "{}", Count());
+  ASSERT_EQ(0, Evaluated);
+}
+
+TEST(LogRateLimiterTest, suppresses_messages_above_limit_within_period) {
+  LogRateLimiter Limiter(2, std::chrono::milliseconds(1000));
+  auto Now = std::chrono::steady_clock::now();
+  uint64_t Suppressed = 0;
+  ASSERT_TRUE(Limiter.allow(Suppressed, Now));
+  ASSERT_TRUE(Limiter.allow(Suppressed, Now));
+  ASSERT_FALSE(Limiter.allow(Suppressed, Now));
+  ASSERT_FALSE(Limiter.allow(Suppressed, Now + std::chrono::milliseconds(500)));
+  ASSERT_EQ(0u, Suppressed);
+}
+
+TEST(LogRateLimiterTest, reports_suppressed_count_in_next_period) {
+  LogRateLimiter Limiter(1, std::chrono::milliseconds(1000));
+  auto Now = std::chrono::steady_clock::now();
+  uint64_t Suppressed = 0;
+  ASSERT_TRUE(Limiter.allow(Suppressed, Now));
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_FALSE(Limiter.allow(Suppressed, Now));
+  }
+  ASSERT_TRUE(Limiter.allow(Suppressed, Now + std::chrono::seconds(1)));
+  ASSERT_EQ(5u, Suppressed);
+  ASSERT_FALSE(Limiter.allow(Suppressed, Now + std::chrono::seconds(1)));
+  ASSERT_TRUE(Limiter.allow(Suppressed, Now + std::chrono::seconds(2)));
+  ASSERT_EQ(1u, Suppressed);
+}
+
+namespace {
+
+/// Number of lines of the file which contain the text.
+size_t countLines(std::string const &Filename, std::string const &Text) {
+  std::ifstream File(Filename);
+  size_t Count = 0;
+  std::string Line;
+  while (std::getline(File, Line)) {
+    if (Line.find(Text) != std::string::npos) {
+      ++Count;
+    }
+  }
+  return Count;
+}
+}
+
+TEST(LoggerTest, errors_are_written_directly) {
+  std::string const Filename = "logger_tests_errors.log";
+  {
+    DW::Logger Logger;
+    Logger.use_log_file(Filename);
+    Logger.dwlog_inner(6, 0, __FILE__, __LINE__, "", "some info");
+    Logger.dwlog_inner(3, 0, __FILE__, __LINE__, "", "some error");
+    // The queued message is written before the error.
+    ASSERT_EQ(1u, countLines(Filename, "some info"));
+    ASSERT_EQ(1u, countLines(Filename, "some error"));
+  }
+  std::remove(Filename.c_str());
+}
+
+TEST(LoggerTest, messages_are_not_lost_when_the_writer_stops) {
+  std::string const Filename = "logger_tests_stop.log";
+  {
+    DW::Logger Logger;
+    Logger.use_log_file(Filename);
+    int const Threads = 4;
+    int const MessagesPerThread = 2000;
+    std::atomic<int> Logged{0};
+    std::vector<std::thread> Loggers;
+    for (int i = 0; i < Threads; ++i) {
+      Loggers.emplace_back([&Logger, &Logged] {
+        for (int j = 0; j < MessagesPerThread; ++j) {
+          Logger.dwlog_inner(6, 0, __FILE__, __LINE__, "", "some message");
+          ++Logged;
+        }
+      });
+    }
+    // Stop while the threads are logging.
+    while (Logged.load() < Threads * MessagesPerThread / 2) {
+      std::this_thread::yield();
+    }
+    Logger.stopWriter();
+    for (auto &Thread : Loggers) {
+      Thread.join();
+    }
+    ASSERT_EQ(static_cast<size_t>(Threads * MessagesPerThread),
+              countLines(Filename, "some message"));
+  }
+  std::remove(Filename.c_str());
+}